@@ -0,0 +1,96 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <math.h>
+#include <stdatomic.h>
+
+#include "arrival.h"
+
+// Log entries are atomic, since the input thread may be reusing one that
+// the output side is looking at. first_arrival and stream_start_wall are
+// set once, before the release store that makes 'arrivals' nonzero, and
+// are read only after an acquire load sees it nonzero.
+#define ARRIVAL_LOG_SIZE 4096
+
+static struct arrival {
+    _Atomic uint64_t samples;   // samples received by the end of this read
+    _Atomic double time;        // monotonic time when it completed
+} arrival_log[ARRIVAL_LOG_SIZE];
+static _Atomic uint64_t arrivals;   // reads logged; written by the input thread
+static uint64_t input_bytes;        // input thread only
+static struct {
+    uint64_t samples;
+    double time;
+} first_arrival;                    // the first read
+static double stream_start_wall;    // wall clock time of sample 0
+
+void arrival_record(size_t bytes, double now, double wall_now)
+{
+    uint64_t i = atomic_load_explicit(&arrivals, memory_order_relaxed);
+    struct arrival *a = &arrival_log[i % ARRIVAL_LOG_SIZE];
+    uint64_t samples;
+
+    input_bytes += bytes;
+    samples = input_bytes / 2;
+    atomic_store_explicit(&a->samples, samples, memory_order_relaxed);
+    atomic_store_explicit(&a->time, now, memory_order_relaxed);
+
+    if (i == 0) {
+        // the stream started a read's worth of samples ago
+        first_arrival.samples = samples;
+        first_arrival.time = now;
+        stream_start_wall = wall_now - samples / SAMPLE_RATE;
+    }
+
+    atomic_store_explicit(&arrivals, i + 1, memory_order_release);
+}
+
+int arrival_started(void)
+{
+    return atomic_load_explicit(&arrivals, memory_order_acquire) > 0;
+}
+
+double arrival_time(uint64_t end)
+{
+    static uint64_t cursor;
+    uint64_t n = atomic_load_explicit(&arrivals, memory_order_acquire);
+
+    if (cursor + ARRIVAL_LOG_SIZE < n)
+        cursor = n - ARRIVAL_LOG_SIZE;
+    while (cursor + 1 < n &&
+           atomic_load_explicit(&arrival_log[cursor % ARRIVAL_LOG_SIZE].samples, memory_order_relaxed) < end)
+        ++cursor;
+
+    return atomic_load_explicit(&arrival_log[cursor % ARRIVAL_LOG_SIZE].time, memory_order_relaxed);
+}
+
+double arrival_wall_time(uint64_t sample)
+{
+    if (!arrival_started())
+        return sample / SAMPLE_RATE;
+
+    return stream_start_wall + sample / SAMPLE_RATE;
+}
+
+double arrival_buffering(uint64_t end, double arrived)
+{
+    if (!arrival_started())
+        return NAN;
+
+    // signed: a frame ending in the first read ends before first_arrival.samples
+    return arrived - (first_arrival.time + (double) ((int64_t) end - (int64_t) first_arrival.samples) / SAMPLE_RATE);
+}
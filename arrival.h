@@ -0,0 +1,58 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP978_ARRIVAL_H
+#define DUMP978_ARRIVAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Frame timing. Each read of input is logged with the number of samples
+// received so far and the time it completed. From that, a frame's start
+// sample maps onto a wall clock anchored at the start of the stream (for
+// --timestamps), and the arrival of its last sample gives the delay
+// until it is output (for --latency-report).
+//
+// Reads are logged by one thread (the input thread) and looked up by one
+// other (the output side), which may run concurrently.
+
+#define SAMPLE_RATE 2083334.0
+
+// Log a read of 'bytes' bytes of input that completed at monotonic time
+// 'now' and wall clock time 'wall_now'. Input thread only.
+void arrival_record(size_t bytes, double now, double wall_now);
+
+// Nonzero once any read has been logged
+int arrival_started(void);
+
+// Return the time that input up to sample 'end' had arrived. Frames must
+// be looked up in order, since the search carries on from where the last
+// one finished. Only valid once arrival_started().
+double arrival_time(uint64_t end);
+
+// Return the wall clock time of sample 'sample'; before any read has been
+// logged, the time since the start of the stream.
+double arrival_wall_time(uint64_t sample);
+
+// Return how long input had been buffered before sample 'end' arrived at
+// 'arrived' (from arrival_time()): how much later it arrived than it would
+// have from a source delivering samples in real time from the first read.
+// A frame ending in the first read arrived early, with positive latency.
+// NAN if no read has been logged.
+double arrival_buffering(uint64_t end, double arrived);
+
+#endif
@@ -0,0 +1,85 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "arrival.h"
+
+// Log a few reads with made-up times and check the times and latencies
+// worked out for frames ending in them. The arrival log is global, so
+// this is one sequence of checks over one stream.
+
+#define READ_SAMPLES 32768
+
+static int close_to(double a, double b)
+{
+    return fabs(a - b) < 1e-9;
+}
+
+static int check(const char *what, double got, double expected)
+{
+    if (!close_to(got, expected)) {
+        fprintf(stderr, "%s: FAIL: expected %.9f, got %.9f\n", what, expected, got);
+        return 0;
+    }
+
+    fprintf(stderr, "%s: PASS\n", what);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    const double start = 100.0, start_wall = 1000.0;
+    const double read_time = READ_SAMPLES / SAMPLE_RATE;
+    int all_ok = 1;
+
+    if (arrival_started() || !isnan(arrival_buffering(1000, start))) {
+        fprintf(stderr, "before any read: FAIL: arrival log not empty\n");
+        all_ok = 0;
+    } else {
+        fprintf(stderr, "before any read: PASS\n");
+    }
+    all_ok &= check("wall time before any read", arrival_wall_time(READ_SAMPLES), read_time);
+
+    // the first read takes as long as its samples span; the second turns
+    // up half a second late
+    arrival_record(READ_SAMPLES * 2, start, start_wall);
+    arrival_record(READ_SAMPLES * 2, start + read_time + 0.5, start_wall + read_time + 0.5);
+
+    all_ok &= check("wall time of the first read", arrival_wall_time(READ_SAMPLES), start_wall);
+    all_ok &= check("wall time of sample 0", arrival_wall_time(0), start_wall - read_time);
+
+    // a frame ending partway through the first read arrived early, not
+    // (as an unsigned sample difference would have it) ages ago
+    all_ok &= check("arrival in the first read", arrival_time(20000), start);
+    all_ok &= check("buffering in the first read", arrival_buffering(20000, start),
+                    (READ_SAMPLES - 20000) / SAMPLE_RATE);
+    if (!(arrival_buffering(20000, start) > 0)) {
+        fprintf(stderr, "buffering in the first read is positive: FAIL\n");
+        all_ok = 0;
+    }
+
+    all_ok &= check("arrival at the end of the first read", arrival_time(READ_SAMPLES), start);
+    all_ok &= check("arrival in the second read", arrival_time(READ_SAMPLES + 1), start + read_time + 0.5);
+    all_ok &= check("buffering at the end of the second read",
+                    arrival_buffering(READ_SAMPLES * 2, start + read_time + 0.5), 0.5);
+
+    return all_ok ? 0 : 1;
+}
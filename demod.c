@@ -0,0 +1,691 @@
+//
+// Copyright 2015, Oliver Jowett <oliver@mutability.co.uk>
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it  
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your  
+// option) any later version.  
+//
+// This file is distributed in the hope that it will be useful, but  
+// WITHOUT ANY WARRANTY; without even the implied warranty of  
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU  
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License  
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "uat.h"
+#include "fec.h"
+#include "frontend.h"
+#include "demod.h"
+#include "stats.h"
+
+static int check_sync_word(const int16_t *dphi, uint64_t pattern, int16_t *center);
+static int demod_adsb_frames(const int16_t *dphi, uint8_t *const *to, int fec_retries, int *skip, int *rs_errors,
+                             uint64_t *fec_ticks);
+static int demod_uplink_frames(const int16_t *dphi, uint8_t *const *to, int fec_retries, int *skip, int *rs_errors,
+                               uint64_t *fec_ticks);
+static void demod_frame(const int16_t *dphi, uint8_t *frame, int bytes, int16_t center_dphi);
+static void demod_uplink_blocks(const int16_t *dphi, uint8_t blocks[][UPLINK_BLOCK_BYTES], int16_t center_dphi);
+static void demod_confidence(const int16_t *dphi, uint16_t *confidence, int bytes, int16_t center_dphi);
+
+#define ADSB_SYNC_WORD   0xEACDDA4E2UL
+#define UPLINK_SYNC_WORD 0x153225B1DUL
+
+#define MAX_SYNC_ERRORS 4
+
+// check that there is a valid sync word starting at 'dphi'
+// that matches the sync word 'pattern'. Place the dphi
+// threshold to use for bit slicing in '*center'. Return 1
+// if the sync word is OK, 0 on failure
+static int check_sync_word(const int16_t *dphi, uint64_t pattern, int16_t *center)
+{
+    int i;
+    int32_t dphi_zero_total = 0;
+    int zero_bits = 0;
+    int32_t dphi_one_total = 0;
+    int one_bits = 0;
+    int error_bits;
+
+    // find mean dphi for zero and one bits;
+    // take the mean of the two as our central value
+
+    for (i = 0; i < SYNC_BITS; ++i) {
+        if (pattern & ((uint64_t)1 << (35-i))) {
+            ++one_bits;
+            dphi_one_total += dphi[i*2];
+        } else {
+            ++zero_bits;
+            dphi_zero_total += dphi[i*2];
+        }
+    }
+
+    dphi_zero_total /= zero_bits;
+    dphi_one_total /= one_bits;
+
+    *center = (dphi_one_total + dphi_zero_total) / 2;
+
+    // recheck sync word using our center value
+    error_bits = 0;
+    for (i = 0; i < SYNC_BITS; ++i) {
+        if (pattern & ((uint64_t)1 << (35-i))) {
+            if (dphi[i*2] < *center)
+                ++error_bits;
+        } else {
+            if (dphi[i*2] >= *center)
+                ++error_bits;
+        }
+    }
+
+    //fprintf(stdout, "check_sync_word: center=%.0fkHz, errors=%d\n", *center * 2083334.0 / 65536 / 1000, error_bits);
+
+    return (error_bits <= MAX_SYNC_ERRORS);
+}
+
+// Bit-parallel sync search.
+//
+// Each dphi is sliced to a single bit (dphi > 0), and the bits for the
+// two sample phases (even and odd samples) are packed into separate
+// bitstreams of 64-bit words: stream bit k is bit (k%64) of word (k/64).
+//
+// Rather than shifting one bit at a time through a 36-bit register and
+// comparing it against the sync words, we look at 64 candidate start
+// positions at once. For each of the 36 sync bits, we extract the
+// 64-bit window of the stream that starts at (base + sync bit index):
+// bit N of that window is the sliced bit that would be that sync bit if
+// a frame started at base + N. XORing it with the expected sync bit
+// gives a mask of candidates where that sync bit is in error.
+//
+// The error masks are accumulated with bit-sliced saturating counters:
+// err[K] has bit N set if candidate N has seen more than K errors so far.
+// The uplink sync word is the complement of the ADS-B sync word, so
+// a bit that is in error for one is correct for the other, and a second
+// set of counters fed with the inverted mask tracks uplink errors for free.
+//
+// Candidates that end with at most MAX_SYNC_ERRORS errors for either
+// word are returned by sync_scan_next() for check_sync_word() / demodulation.
+
+#define SYNC_MASK ((((uint64_t)1)<<SYNC_BITS)-1)
+
+#if (ADSB_SYNC_WORD ^ UPLINK_SYNC_WORD) != 0xFFFFFFFFFUL
+#error "sync search assumes the uplink sync word is the complement of the ADS-B sync word"
+#endif
+
+#if MAX_SYNC_ERRORS != 4
+#error "sync search counters are sized for MAX_SYNC_ERRORS == 4"
+#endif
+
+// samples per bitstream word: 64 bits, two samples per bit
+#define SYNC_WORD_SAMPLES 128
+
+// struct sync_scan holds enough packed words for SYNC_SCAN_MAX_SAMPLES,
+// plus one word of slack so that sync_window() may read one word past
+// the last window
+#if SYNC_SCAN_MAX_SAMPLES % SYNC_WORD_SAMPLES != 0
+#error "sync_scan bitstream arrays are sized in whole words"
+#endif
+
+// slice and pack 'words' words of each bitstream from 'dphi'.
+// Reads dphi[0] .. dphi[words * SYNC_WORD_SAMPLES - 1].
+static void pack_sync_bits(struct sync_scan *scan, const int16_t *dphi, int words)
+{
+    int w, n;
+
+    for (w = 0; w < words; ++w) {
+        uint64_t bits0 = 0, bits1 = 0;
+
+        for (n = 0; n < 64; ++n) {
+            bits0 |= (uint64_t)(dphi[0] > 0) << n;
+            bits1 |= (uint64_t)(dphi[1] > 0) << n;
+            dphi += 2;
+        }
+
+        scan->bits0[w] = bits0;
+        scan->bits1[w] = bits1;
+    }
+}
+
+// return the 64 stream bits starting at stream bit 'pos'
+static inline uint64_t sync_window(const uint64_t *bits, unsigned pos)
+{
+    unsigned i = pos / 64, shift = pos % 64;
+
+    // (x << 1) << (63 - shift) avoids an undefined shift by 64 when shift == 0
+    return (bits[i] >> shift) | ((bits[i+1] << 1) << (63 - shift));
+}
+
+// Test the 64 candidate start positions base .. base+63 of one
+// bitstream. Set bit N of '*adsb' / '*uplink' if a frame starting at
+// base + N has at most MAX_SYNC_ERRORS errors in its ADS-B / uplink
+// sync word.
+static void sync_search(const uint64_t *bits, unsigned base, uint64_t *adsb, uint64_t *uplink)
+{
+    // a1..a5: candidates with at least 1..5 ADS-B sync errors
+    // u1..u5: candidates with at least 1..5 uplink sync errors
+    uint64_t a1 = 0, a2 = 0, a3 = 0, a4 = 0, a5 = 0;
+    uint64_t u1 = 0, u2 = 0, u3 = 0, u4 = 0, u5 = 0;
+    int i;
+
+    for (i = 0; i < SYNC_BITS; ++i) {
+        uint64_t window = sync_window(bits, base + i);
+        uint64_t adsb_err = (ADSB_SYNC_WORD & ((uint64_t)1 << (35-i))) ? ~window : window;
+        uint64_t uplink_err = ~adsb_err;
+
+        a5 |= a4 & adsb_err;
+        a4 |= a3 & adsb_err;
+        a3 |= a2 & adsb_err;
+        a2 |= a1 & adsb_err;
+        a1 |= adsb_err;
+
+        u5 |= u4 & uplink_err;
+        u4 |= u3 & uplink_err;
+        u3 |= u2 & uplink_err;
+        u2 |= u1 & uplink_err;
+        u1 |= uplink_err;
+
+        // On noise, every candidate has usually failed both words
+        // after 20-30 bits; stop early when that happens.
+        if ((i & 7) == 7 && (a5 & u5) == ~(uint64_t)0)
+            break;
+    }
+
+    *adsb = ~a5;
+    *uplink = ~u5;
+}
+
+//
+// Noise floor and energy squelch.
+//
+// Most of the time there is nothing but noise on frequency. We take the
+// power of each block of SQUELCH_BLOCK_SAMPLES samples (a subtraction of
+// running energy totals) and track the noise floor with an asymmetric
+// moving average that follows drops in power quickly but rises only
+// slowly, so that it settles near the quiet level between bursts rather
+// than being dragged up by the bursts themselves. The average is taken in
+// dB so that a strong burst pulls the floor up no more than a weak one
+// does. If the squelch is enabled, a search window is only searched if
+// one of the blocks it touches is at least 'margin' dB above the floor.
+//
+// Block boundaries are fixed relative to the start of the stream, and the
+// floor estimate and open/closed decision for each block are made once,
+// when the block is first seen, and remembered for later searches that
+// overlap it.
+//
+
+#if (SYNC_SCAN_MAX_SAMPLES / SQUELCH_BLOCK_SAMPLES + 2) > SQUELCH_HISTORY
+#error "squelch history does not cover a whole sync search buffer"
+#endif
+
+// moving average weights for power below / above the current floor
+#define SQUELCH_FALL (1.0f / 16)
+#define SQUELCH_RISE (1.0f / 4096)
+
+void squelch_init(struct squelch *squelch, int enabled, float margin_db)
+{
+    squelch->enabled = enabled;
+    squelch->margin = margin_db;
+    squelch->floor = NAN;
+    squelch->next = 0;
+    squelch->searched = squelch->skipped = 0;
+}
+
+#define SQUELCH_SLOT(sample) (((sample) / SQUELCH_BLOCK_SAMPLES) % SQUELCH_HISTORY)
+
+// Fold every block that ends at or before stream offset 'end' into the
+// noise floor and decide whether it is open. 'energy' holds running
+// energy totals starting at stream offset 'offset'.
+static void squelch_update(struct squelch *squelch, const uint32_t *energy, uint64_t offset, uint64_t end)
+{
+    // a gap since the last search (should not happen): restart at the
+    // first whole block
+    if (squelch->next < offset)
+        squelch->next = (offset + SQUELCH_BLOCK_SAMPLES - 1) / SQUELCH_BLOCK_SAMPLES * SQUELCH_BLOCK_SAMPLES;
+
+    while (squelch->next + SQUELCH_BLOCK_SAMPLES <= end) {
+        const uint32_t *e = energy + (squelch->next - offset);
+        unsigned slot = SQUELCH_SLOT(squelch->next);
+        // never log(0): every sample has nonzero energy, as (2x - 255) is odd
+        float p = energy_to_dbfs(e[SQUELCH_BLOCK_SAMPLES] - e[0], SQUELCH_BLOCK_SAMPLES);
+
+        if (isnan(squelch->floor))
+            squelch->floor = p;
+
+        squelch->block_floor[slot] = squelch->floor;
+        squelch->open[slot] = (p > squelch->floor + squelch->margin);
+        if (p < squelch->floor)
+            squelch->floor += (p - squelch->floor) * SQUELCH_FALL;
+        else
+            squelch->floor += (p - squelch->floor) * SQUELCH_RISE;
+
+        squelch->next += SQUELCH_BLOCK_SAMPLES;
+    }
+}
+
+// return nonzero if any block touched by the sync words of the 64
+// candidates starting at 'base' is open. 'base' may be negative for the
+// first window of a search, which starts before the buffer does.
+static int squelch_window_open(const struct sync_scan *scan, int base)
+{
+    uint64_t first = scan->offset + base * 2;
+    uint64_t last = first + 127 + SYNC_BITS * 2;
+    uint64_t sample;
+
+    for (sample = first - first % SQUELCH_BLOCK_SAMPLES; sample <= last; sample += SQUELCH_BLOCK_SAMPLES)
+        if (scan->squelch->open[SQUELCH_SLOT(sample)])
+            return 1;
+
+    return 0;
+}
+
+void sync_scan_init(struct sync_scan *scan, const int16_t *dphi, const uint32_t *energy, uint64_t offset,
+                    int nstarts, struct squelch *squelch)
+{
+    uint64_t start = stats_ticks();
+
+    // the last search window reads up to bit (nstarts + 63 + SYNC_BITS)
+    // plus one word, which is well inside the frame lookahead
+    pack_sync_bits(scan, dphi, (nstarts + 63 + SYNC_BITS) / 64 + 2);
+
+    scan->nstarts = nstarts;
+    scan->base = scan->pos = 0;
+    scan->candidates = 0;
+    scan->offset = offset;
+    scan->squelch = squelch;
+
+    // cover the blocks touched by the last window's sync words; these
+    // are also well inside the lookahead
+    if (squelch) {
+        squelch_update(squelch, energy, offset,
+                       offset + nstarts * 2 + 127 + SYNC_BITS * 2 + SQUELCH_BLOCK_SAMPLES);
+        scan->squelch_searched = squelch->searched;
+        scan->squelch_skipped = squelch->skipped;
+    }
+
+    scan->ticks = stats_ticks() - start;
+}
+
+// Add the time spent on this buffer and what the squelch did with it to
+// the stats, once per buffer rather than once per search window
+static void sync_scan_count(struct sync_scan *scan)
+{
+    STATS_ADD(ticks[STAGE_SYNC], scan->ticks);
+    STATS_ADD(calls[STAGE_SYNC], 1);
+    scan->ticks = 0;
+
+    if (scan->squelch) {
+        STATS_ADD(squelch_searched, scan->squelch->searched - scan->squelch_searched);
+        STATS_ADD(squelch_skipped, scan->squelch->skipped - scan->squelch_skipped);
+        scan->squelch_searched = scan->squelch->searched;
+        scan->squelch_skipped = scan->squelch->skipped;
+    }
+}
+
+int sync_scan_next(struct sync_scan *scan, struct sync_candidate *cand)
+{
+    int n;
+    uint64_t bit, start = stats_ticks();
+
+    while (!scan->candidates) {
+        int base = scan->pos;
+        int phase, count;
+
+        if (base >= scan->nstarts) {
+            scan->ticks += stats_ticks() - start;
+            sync_scan_count(scan);
+            return 0;
+        }
+
+        // windows are aligned to the stream rather than to the buffer, so
+        // that the squelch decides the same way however the input is split
+        phase = (int) ((scan->offset / 2 + base) % 64);
+        count = 64 - phase;
+        if (count > scan->nstarts - base)
+            count = scan->nstarts - base;
+        scan->pos = base + count;
+        scan->base = base;
+
+        if (scan->squelch && scan->squelch->enabled) {
+            if (!squelch_window_open(scan, base - phase)) {
+                scan->squelch->skipped += count * 2;
+                continue;
+            }
+            scan->squelch->searched += count * 2;
+        }
+
+        sync_search(scan->bits0, base, &scan->adsb0, &scan->uplink0);
+        sync_search(scan->bits1, base, &scan->adsb1, &scan->uplink1);
+
+        scan->candidates = scan->adsb0 | scan->uplink0 | scan->adsb1 | scan->uplink1;
+        if (count < 64)
+            scan->candidates &= (((uint64_t)1) << count) - 1;
+    }
+
+    n = __builtin_ctzll(scan->candidates);
+    bit = ((uint64_t)1) << n;
+
+    scan->candidates &= ~bit;
+    cand->startbit = scan->base + n;
+
+    // prefer downlink frames if both sync words matched
+    if ((scan->adsb0 | scan->adsb1) & bit) {
+        cand->type = FRAME_ADSB;
+        cand->index = cand->startbit * 2 + ((scan->adsb0 & bit) ? 0 : 1);
+    } else {
+        cand->type = FRAME_UPLINK;
+        cand->index = cand->startbit * 2 + ((scan->uplink0 & bit) ? 0 : 1);
+    }
+
+    if (scan->squelch)
+        cand->noise_floor = scan->squelch->block_floor[SQUELCH_SLOT(scan->offset + cand->index)];
+    else
+        cand->noise_floor = NAN;
+
+    STATS_ADD(frametype[cand->type].candidates, 1);
+    scan->ticks += stats_ticks() - start;
+    return 1;
+}
+
+void sync_scan_resume(struct sync_scan *scan, int startbit)
+{
+    // samples covered by a demodulated frame count as searched, so that
+    // the squelch statistics cover the whole input; anything past the end
+    // of this search is counted by the next one, which resumes there too
+    int end = (startbit < scan->nstarts ? startbit : scan->nstarts);
+
+    if (scan->squelch && scan->squelch->enabled && end > scan->pos)
+        scan->squelch->searched += (end - scan->pos) * 2;
+
+    scan->candidates = 0;
+    scan->pos = startbit;
+}
+
+int sync_scan_end(const struct sync_scan *scan)
+{
+    return scan->pos;
+}
+
+int demod_candidate(const int16_t *dphi, const uint32_t *energy, demod_frame_type_t type, int fec_retries,
+                    struct demod_result *result)
+{
+    uint8_t demod_buf_b[UPLINK_FRAME_BYTES];
+    uint8_t *const to[2] = { result->data, demod_buf_b };
+    int skip[2], rs[2];
+    uint64_t start = stats_ticks(), fec_ticks = 0;
+    int synced;
+
+    // try to demodulate both at the candidate position and at the next
+    // sample, and pick the one with fewer errors.
+    if (type == FRAME_ADSB)
+        synced = demod_adsb_frames(dphi, to, fec_retries, skip, rs, &fec_ticks);
+    else
+        synced = demod_uplink_frames(dphi, to, fec_retries, skip, rs, &fec_ticks);
+
+    STATS_ADD(ticks[STAGE_DEMOD], stats_ticks() - start - fec_ticks);
+    STATS_ADD(calls[STAGE_DEMOD], 1);
+    if (synced) {
+        STATS_ADD(ticks[STAGE_FEC], fec_ticks);
+        STATS_ADD(calls[STAGE_FEC], 1);
+    }
+
+    if (skip[0] && rs[0] <= rs[1]) {
+        result->shift = 0;
+        result->bits = skip[0];
+        result->rs_errors = rs[0];
+    } else if (skip[1] && rs[1] <= rs[0]) {
+        result->shift = 1;
+        result->bits = skip[1];
+        result->rs_errors = rs[1];
+        memcpy(result->data, demod_buf_b, sizeof(demod_buf_b));
+    } else {
+        // demod failed
+        if (synced)
+            STATS_ADD(frametype[type].rs_failed, 1);
+        else
+            STATS_ADD(frametype[type].sync_rejected, 1);
+        return 0;
+    }
+
+    STATS_ADD(frametype[type].frames, 1);
+    if (result->rs_errors) {
+        STATS_ADD(frametype[type].rs_corrected, 1);
+        STATS_ADD(frametype[type].rs_errors, result->rs_errors);
+    }
+
+    result->type = type;
+    result->signal_strength = energy_to_dbfs(energy[result->shift + result->bits * 2] - energy[result->shift],
+                                             result->bits * 2);
+    result->noise_floor = NAN;
+    return 1;
+}
+
+// demodulate 'bytes' bytes from phase differences at 'dphi' into 'frame',
+// using 'center_dphi' as the bit slicing threshold
+static void demod_frame(const int16_t *dphi, uint8_t *frame, int bytes, int16_t center_dphi)
+{
+    while (--bytes >= 0) {
+        uint8_t b = 0;
+        if (dphi[0] > center_dphi) b |= 0x80;
+        if (dphi[2] > center_dphi) b |= 0x40;
+        if (dphi[4] > center_dphi) b |= 0x20;
+        if (dphi[6] > center_dphi) b |= 0x10;
+        if (dphi[8] > center_dphi) b |= 0x08;
+        if (dphi[10] > center_dphi) b |= 0x04;
+        if (dphi[12] > center_dphi) b |= 0x02;
+        if (dphi[14] > center_dphi) b |= 0x01;
+        *frame++ = b;
+        dphi += 16;
+    }
+}
+
+#if defined(__SSE2__)
+// the 8 bits of the byte at 'dphi' (every other value) as 16-bit lanes,
+// last bit first, so that a movemask puts the first bit at the top
+static inline __m128i byte_bits_sse2(const int16_t *dphi)
+{
+    __m128i a = _mm_loadu_si128((const __m128i *) dphi);
+    __m128i b = _mm_loadu_si128((const __m128i *) (dphi + 8));
+    __m128i bits;
+
+    // keep the even values, sign-extended, and pack them back to 16 bits
+    a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+    b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+    bits = _mm_packs_epi32(a, b);
+
+    bits = _mm_shuffle_epi32(bits, _MM_SHUFFLE(1, 0, 3, 2));
+    bits = _mm_shufflelo_epi16(bits, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_shufflehi_epi16(bits, _MM_SHUFFLE(0, 1, 2, 3));
+}
+#elif defined(__aarch64__)
+static inline uint8_t slice_byte_neon(const int16_t *dphi, int16x8_t center)
+{
+    static const uint16_t weights[8] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+    int16x8_t bits = vld2q_s16(dphi).val[0];
+    return vaddvq_u16(vandq_u16(vcgtq_s16(bits, center), vld1q_u16(weights)));
+}
+#endif
+
+// demodulate a whole interleaved uplink frame from phase differences at
+// 'dphi' as demod_frame() does, but write each byte straight to its place
+// in the deinterleaved blocks
+static void demod_uplink_blocks(const int16_t *dphi, uint8_t blocks[][UPLINK_BLOCK_BYTES], int16_t center_dphi)
+{
+    int block, pos;
+
+#if defined(__SSE2__)
+    const __m128i center = _mm_set1_epi16(center_dphi);
+
+    // two bytes, for two neighbouring blocks, per compare and movemask
+    for (pos = 0; pos < UPLINK_BLOCK_BYTES; ++pos) {
+        for (block = 0; block < UPLINK_FRAME_BLOCKS; block += 2) {
+            __m128i first = _mm_cmpgt_epi16(byte_bits_sse2(dphi), center);
+            __m128i second = _mm_cmpgt_epi16(byte_bits_sse2(dphi + 16), center);
+            unsigned mask = _mm_movemask_epi8(_mm_packs_epi16(first, second));
+
+            blocks[block][pos] = mask & 0xFF;
+            blocks[block + 1][pos] = mask >> 8;
+            dphi += 32;
+        }
+    }
+#elif defined(__aarch64__)
+    const int16x8_t center = vdupq_n_s16(center_dphi);
+
+    for (pos = 0; pos < UPLINK_BLOCK_BYTES; ++pos) {
+        for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block) {
+            blocks[block][pos] = slice_byte_neon(dphi, center);
+            dphi += 16;
+        }
+    }
+#else
+    for (pos = 0; pos < UPLINK_BLOCK_BYTES; ++pos) {
+        for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block) {
+            demod_frame(dphi, &blocks[block][pos], 1, center_dphi);
+            dphi += 16;
+        }
+    }
+#endif
+}
+
+// compute the confidence of each byte demodulated by demod_frame(): the
+// distance of its least certain bit from the slicing threshold
+static void demod_confidence(const int16_t *dphi, uint16_t *confidence, int bytes, int16_t center_dphi)
+{
+    while (--bytes >= 0) {
+        unsigned least = 65535;
+        int i;
+
+        for (i = 0; i < 16; i += 2) {
+            unsigned d = abs(dphi[i] - center_dphi);
+            if (d < least)
+                least = d;
+        }
+
+        *confidence++ = least;
+        dphi += 16;
+    }
+}
+
+// Demodulate ADSB (Long UAT or Basic UAT) downlink frames with the
+// first sync bit at 'dphi' and at 'dphi+1', storing them into to[0] and
+// to[1] (each LONG_FRAME_BYTES), and correct both as one batch.
+// For each alignment, set skip[] to 0 if demodulation failed, or the
+// number of bits (not samples) consumed if it was OK, and rs_errors[]
+// to the number of corrected errors, or 9999 if demodulation failed.
+// If error correction fails, retry up to 'fec_retries' times with
+// erasures (see retry_adsb_frame).
+// Returns the number of alignments that passed the sync word check, and
+// adds the time spent in error correction to '*fec_ticks'.
+static int demod_adsb_frames(const int16_t *dphi, uint8_t *const *to, int fec_retries, int *skip, int *rs_errors,
+                             uint64_t *fec_ticks)
+{
+    struct fec_frame frames[2];
+    int16_t center_dphi[2];
+    int shift[2];
+    int i, n = 0;
+    uint64_t start;
+
+    for (i = 0; i < 2; ++i) {
+        skip[i] = 0;
+        rs_errors[i] = 9999;
+        if (!check_sync_word(dphi + i, ADSB_SYNC_WORD, &center_dphi[i]))
+            continue;
+
+        demod_frame(dphi + i + SYNC_BITS*2, to[i], LONG_FRAME_BYTES, center_dphi[i]);
+        frames[n].data = to[i];
+        frames[n].confidence = NULL;
+        shift[n++] = i;
+    }
+
+    start = stats_ticks();
+    correct_adsb_frames(frames, n, 0);
+    *fec_ticks += stats_ticks() - start;
+
+    for (i = 0; i < n; ++i) {
+        int s = shift[i];
+        int frametype = frames[i].frametype;
+
+        if (frametype < 0 && fec_retries > 0) {
+            // only pay for the confidence values when they are needed
+            uint16_t confidence[LONG_FRAME_BYTES];
+
+            demod_confidence(dphi + s + SYNC_BITS*2, confidence, LONG_FRAME_BYTES, center_dphi[s]);
+            start = stats_ticks();
+            frametype = retry_adsb_frame(&frames[i], confidence, fec_retries);
+            *fec_ticks += stats_ticks() - start;
+        }
+        rs_errors[s] = frames[i].rs_errors;
+
+        if (frametype == 1)
+            skip[s] = (SYNC_BITS + SHORT_FRAME_BITS);
+        else if (frametype == 2)
+            skip[s] = (SYNC_BITS + LONG_FRAME_BITS);
+    }
+
+    return n;
+}
+
+// Demodulate uplink frames with the first sync bit at 'dphi' and at
+// 'dphi+1', storing them into to[0] and to[1] (each UPLINK_FRAME_BYTES),
+// and correct both as one batch. Sets skip[] and rs_errors[], and
+// returns, as demod_adsb_frames does.
+// If error correction fails, retry up to 'fec_retries' times with
+// erasures (see retry_uplink_frame).
+static int demod_uplink_frames(const int16_t *dphi, uint8_t *const *to, int fec_retries, int *skip, int *rs_errors,
+                               uint64_t *fec_ticks)
+{
+    uint8_t blocks[2][UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+    struct fec_frame frames[2];
+    int16_t center_dphi[2];
+    int shift[2];
+    int i, n = 0;
+    uint64_t start;
+
+    for (i = 0; i < 2; ++i) {
+        skip[i] = 0;
+        rs_errors[i] = 9999;
+        if (!check_sync_word(dphi + i, UPLINK_SYNC_WORD, &center_dphi[i]))
+            continue;
+
+        demod_uplink_blocks(dphi + i + SYNC_BITS*2, blocks[i], center_dphi[i]);
+        frames[n].data = &blocks[i][0][0];
+        frames[n].to = to[i];
+        frames[n].confidence = NULL;
+        shift[n++] = i;
+    }
+
+    start = stats_ticks();
+    correct_uplink_frames(frames, n, 0);
+    *fec_ticks += stats_ticks() - start;
+
+    for (i = 0; i < n; ++i) {
+        int s = shift[i];
+        int frametype = frames[i].frametype;
+
+        if (frametype < 0 && fec_retries > 0) {
+            uint16_t confidence[UPLINK_FRAME_BYTES];
+
+            demod_confidence(dphi + s + SYNC_BITS*2, confidence, UPLINK_FRAME_BYTES, center_dphi[s]);
+            start = stats_ticks();
+            frametype = retry_uplink_frame(&frames[i], confidence, fec_retries);
+            *fec_ticks += stats_ticks() - start;
+        }
+        rs_errors[s] = frames[i].rs_errors;
+
+        if (frametype == 1)
+            skip[s] = (UPLINK_FRAME_BITS+SYNC_BITS);
+    }
+
+    return n;
+}
@@ -0,0 +1,159 @@
+//
+// Copyright 2015, Oliver Jowett <oliver@mutability.co.uk>
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP978_DEMOD_H
+#define DUMP978_DEMOD_H
+
+#include <stdint.h>
+
+#include "uat.h"
+#include "frontend.h"
+
+#define SYNC_BITS (36)
+
+// Samples needed past a candidate start position before it can be searched
+// and demodulated: a sync word plus a maximum-length frame, with slack for
+// the sync search and for the one-sample-later demodulation attempt.
+#define DEMOD_LOOKAHEAD ((SYNC_BITS + SYNC_BITS + UPLINK_FRAME_BITS) * 2)
+
+// Largest buffer, in samples, that may be passed to sync_scan_init()
+#define SYNC_SCAN_MAX_SAMPLES 65536
+
+typedef enum {
+    FRAME_ADSB,
+    FRAME_UPLINK
+} demod_frame_type_t;
+
+// A position where a sync word was found
+struct sync_candidate {
+    int startbit;              // candidate start, in bits from the start of the buffer
+    int index;                 // sample index of the first sync bit (startbit*2 or startbit*2+1)
+    demod_frame_type_t type;   // which sync word matched
+    float noise_floor;         // noise floor estimate before the candidate, dBFS, or NAN if unknown
+};
+
+// block size for noise floor estimation and squelch decisions
+#define SQUELCH_BLOCK_SAMPLES 128
+
+// number of recent blocks whose squelch state is remembered; enough to
+// cover a whole sync search buffer
+#define SQUELCH_HISTORY 1024
+
+// Noise floor estimate and energy squelch: track the noise floor, and
+// optionally skip the sync search over stretches of samples whose power is
+// not sufficiently above it.
+//
+// Blocks are aligned to the start of the input stream and each is folded
+// into the estimate exactly once, so the results do not depend on how the
+// input is split into search buffers.
+struct squelch {
+    int enabled;            // gate the sync search?
+    float margin;           // dB above the floor needed to search
+    float floor;            // noise floor estimate, dBFS; NAN until known
+    uint64_t next;          // stream offset of the next block to fold in, in samples
+    uint64_t searched;      // start samples searched (or inside a frame)
+    uint64_t skipped;       // start samples skipped
+    uint8_t open[SQUELCH_HISTORY];         // per block: above the squelch threshold?
+    float block_floor[SQUELCH_HISTORY];    // per block: floor estimate before the block
+};
+
+// Sync search state; see sync_scan_init()
+struct sync_scan {
+    int nstarts;
+    int base;
+    int pos;
+    uint64_t adsb0, uplink0, adsb1, uplink1;
+    uint64_t candidates;
+    uint64_t bits0[SYNC_SCAN_MAX_SAMPLES / 128 + 2];
+    uint64_t bits1[SYNC_SCAN_MAX_SAMPLES / 128 + 2];
+    uint64_t offset;
+    struct squelch *squelch;
+
+    // time spent in the search, and the squelch counts when it started;
+    // added to the stats when the search reaches the end of the buffer
+    uint64_t ticks;
+    uint64_t squelch_searched, squelch_skipped;
+};
+
+// A successfully demodulated frame
+struct demod_result {
+    demod_frame_type_t type;
+    int shift;              // sample offset of the frame relative to the candidate index (0 or 1)
+    int bits;               // number of bits consumed, including the sync word
+    int rs_errors;          // number of corrected errors
+    float signal_strength;  // average signal strength of the frame, dBFS
+    float noise_floor;      // noise floor, dBFS, or NAN if unknown; set by the caller
+    uint8_t data[UPLINK_FRAME_BYTES];
+};
+
+/* Set up noise floor tracking, and an energy squelch that searches only
+ * where the signal is at least 'margin_db' dB above the noise floor.
+ * The squelch is disabled (but the floor is still tracked) if 'enabled'
+ * is 0. */
+void squelch_init(struct squelch *squelch, int enabled, float margin_db);
+
+/* Start a sync word search over 'nstarts' candidate start bits.
+ *
+ * 'dphi' holds phase differences (see convert_to_dphi) and must extend
+ * at least DEMOD_LOOKAHEAD samples past the last start position, i.e.
+ * nstarts*2 + DEMOD_LOOKAHEAD samples in total, and no more than
+ * SYNC_SCAN_MAX_SAMPLES.
+ *
+ * 'energy' holds the corresponding running energy totals (see
+ * accumulate_energy) over the same span.
+ *
+ * 'offset' is the stream offset of dphi[0], in samples; successive
+ * searches must overlap or abut.
+ *
+ * If 'squelch' is non-NULL, its noise floor is updated; if it is also
+ * enabled, stretches that stay below the squelch threshold are not
+ * searched.
+ */
+void sync_scan_init(struct sync_scan *scan, const int16_t *dphi, const uint32_t *energy, uint64_t offset,
+                    int nstarts, struct squelch *squelch);
+
+/* Find the next candidate, in increasing order of start bit.
+ * Returns 1 and fills in '*cand' if one was found, or 0 when the
+ * search is complete.
+ */
+int sync_scan_next(struct sync_scan *scan, struct sync_candidate *cand);
+
+/* Continue the search from 'startbit', e.g. after the end of a
+ * successfully demodulated frame. */
+void sync_scan_resume(struct sync_scan *scan, int startbit);
+
+/* Once sync_scan_next() has returned 0, return the start bit where a
+ * subsequent search should begin. This may be past 'nstarts' if a
+ * frame overlapped the end of the search. */
+int sync_scan_end(const struct sync_scan *scan);
+
+/* Try to demodulate a frame of type 'type' whose first sync bit is at
+ * dphi[0] / energy[0], also trying one sample later and keeping the
+ * attempt with fewer errors.
+ *
+ * If error correction fails, it is retried up to 'fec_retries' times with
+ * the bytes whose bits were closest to the slicing threshold marked as
+ * erasures; 0 disables this.
+ *
+ * 'dphi' and 'energy' must extend DEMOD_LOOKAHEAD samples.
+ * Returns 1 and fills in '*result' on success, 0 on failure.
+ */
+int demod_candidate(const int16_t *dphi, const uint32_t *energy, demod_frame_type_t type, int fec_retries,
+                    struct demod_result *result);
+
+#endif
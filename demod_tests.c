@@ -0,0 +1,396 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+
+// The demodulator's helpers are static; test them directly.
+#include "demod.c"
+
+// Plant sync words, with and without bit errors, in random phase
+// differences and check that the bit-parallel sync search finds exactly
+// the candidates that testing every start position one at a time finds.
+
+#define NSTARTS_MAX ((SYNC_SCAN_MAX_SAMPLES - DEMOD_LOOKAHEAD) / 2)
+
+static int16_t dphi[SYNC_SCAN_MAX_SAMPLES];
+static uint32_t energy[SYNC_SCAN_MAX_SAMPLES + 1];
+
+static uint32_t lcg_state = 978;
+
+static uint32_t lcg_next(void)
+{
+    lcg_state = lcg_state * 1103515245 + 12345;
+    return lcg_state >> 8;
+}
+
+static void random_dphi(void)
+{
+    int i;
+
+    for (i = 0; i < SYNC_SCAN_MAX_SAMPLES; ++i)
+        dphi[i] = (int16_t) lcg_next();
+}
+
+// Write sync word 'word' starting at 'startbit', on the even (shift 0) or
+// odd (shift 1) samples, with 'errors' (up to 5) of its bits inverted
+static void plant_sync(int startbit, int shift, uint64_t word, int errors)
+{
+    int i, flipped = 0;
+
+    for (i = 0; i < SYNC_BITS; ++i) {
+        int bit = (word >> (35 - i)) & 1;
+        int16_t level = 6000 + (lcg_next() & 1023);
+
+        // spread the errors over the word: bits 3, 10, 17, 24, 31
+        if (i % 7 == 3 && flipped < errors) {
+            bit = !bit;
+            ++flipped;
+        }
+
+        dphi[(startbit + i) * 2 + shift] = bit ? level : -level;
+    }
+}
+
+// number of bits of 'word' that the values at 'p' (every other one),
+// sliced at zero as the sync search does, get wrong
+static int sync_errors(const int16_t *p, uint64_t word)
+{
+    int i, errors = 0;
+
+    for (i = 0; i < SYNC_BITS; ++i)
+        errors += ((p[i * 2] > 0) != ((word >> (35 - i)) & 1));
+
+    return errors;
+}
+
+// The frame length assumed when a candidate is treated as decoded
+static int decoded_bits(demod_frame_type_t type)
+{
+    return SYNC_BITS + (type == FRAME_ADSB ? LONG_FRAME_BITS : UPLINK_FRAME_BITS);
+}
+
+// Brute force: test both sync words at both sample phases of every start
+// position in turn. If 'resume' is set, every candidate is taken to be a
+// decoded frame and the search carries on after it. Returns the number of
+// candidates, and sets '*end' to where a following search would start.
+static int reference_scan(int nstarts, int resume, struct sync_candidate *cands, int max, int *end)
+{
+    int startbit = 0, n = 0;
+
+    while (startbit < nstarts && n < max) {
+        const int16_t *p = dphi + startbit * 2;
+        int adsb0 = sync_errors(p, ADSB_SYNC_WORD) <= MAX_SYNC_ERRORS;
+        int adsb1 = sync_errors(p + 1, ADSB_SYNC_WORD) <= MAX_SYNC_ERRORS;
+        int uplink0 = sync_errors(p, UPLINK_SYNC_WORD) <= MAX_SYNC_ERRORS;
+        int uplink1 = sync_errors(p + 1, UPLINK_SYNC_WORD) <= MAX_SYNC_ERRORS;
+        struct sync_candidate *c = &cands[n];
+
+        if (!(adsb0 || adsb1 || uplink0 || uplink1)) {
+            ++startbit;
+            continue;
+        }
+
+        c->startbit = startbit;
+        if (adsb0 || adsb1) {
+            c->type = FRAME_ADSB;
+            c->index = startbit * 2 + (adsb0 ? 0 : 1);
+        } else {
+            c->type = FRAME_UPLINK;
+            c->index = startbit * 2 + (uplink0 ? 0 : 1);
+        }
+        ++n;
+
+        startbit += (resume ? decoded_bits(c->type) : 1);
+    }
+
+    *end = (startbit > nstarts ? startbit : nstarts);
+    return n;
+}
+
+// The same through sync_scan_*
+static int sync_scan(int nstarts, int resume, struct sync_candidate *cands, int max, int *end)
+{
+    static struct sync_scan scan;
+    struct sync_candidate cand;
+    int n = 0;
+
+    sync_scan_init(&scan, dphi, energy, 0, nstarts, NULL);
+    while (n < max && sync_scan_next(&scan, &cand)) {
+        cands[n++] = cand;
+        if (resume)
+            sync_scan_resume(&scan, cand.startbit + decoded_bits(cand.type));
+    }
+
+    *end = sync_scan_end(&scan);
+    return n;
+}
+
+#define MAX_CANDIDATES 4096
+
+static int compare_scans(const char *name, int nstarts, int resume)
+{
+    static struct sync_candidate expected[MAX_CANDIDATES], got[MAX_CANDIDATES];
+    int n_expected, n_got, end_expected, end_got, i;
+
+    n_expected = reference_scan(nstarts, resume, expected, MAX_CANDIDATES, &end_expected);
+    n_got = sync_scan(nstarts, resume, got, MAX_CANDIDATES, &end_got);
+
+    for (i = 0; i < n_expected && i < n_got; ++i) {
+        if (got[i].startbit != expected[i].startbit || got[i].index != expected[i].index ||
+            got[i].type != expected[i].type || !isnan(got[i].noise_floor)) {
+            fprintf(stderr, "%s: FAIL: candidate %d: expected start %d index %d type %d, got start %d index %d type %d\n",
+                    name, i, expected[i].startbit, expected[i].index, expected[i].type,
+                    got[i].startbit, got[i].index, got[i].type);
+            return 0;
+        }
+    }
+
+    if (n_got != n_expected) {
+        fprintf(stderr, "%s: FAIL: expected %d candidates, got %d\n", name, n_expected, n_got);
+        return 0;
+    }
+
+    if (end_got != end_expected) {
+        fprintf(stderr, "%s: FAIL: expected the search to end at %d, got %d\n", name, end_expected, end_got);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Plant words with 'errors' errors at spaced-out start positions (so
+// that every offset within a 64-bit word, including those whose sync
+// word straddles two, comes up) and at the last start position or the
+// first one past the end, then compare the searches with and without
+// resuming after each candidate. The planted words themselves must be
+// found, or not, according to their errors; and check_sync_word, which
+// recentres its threshold, must agree with that.
+static int test_sync_scan(int nstarts, int errors, int type, int shift, int at_end)
+{
+    static struct sync_candidate cands[MAX_CANDIDATES];
+    uint64_t word = (type == FRAME_ADSB ? ADSB_SYNC_WORD : UPLINK_SYNC_WORD);
+    int planted[MAX_CANDIDATES];
+    int n_planted = 0, n, end, i, p;
+    char name[128];
+    int ok = 1;
+
+    snprintf(name, sizeof(name), "sync search, %d starts, %s, %d errors, shift %d, %s end",
+             nstarts, type == FRAME_ADSB ? "ADS-B" : "uplink", errors, shift,
+             at_end ? "word at the" : "word past the");
+
+    random_dphi();
+    for (p = lcg_next() % 64; p + SYNC_BITS + 1 < nstarts - 1; p += SYNC_BITS + 1 + lcg_next() % 64) {
+        plant_sync(p, shift, word, errors);
+        planted[n_planted++] = p;
+    }
+    p = (at_end ? nstarts - 1 : nstarts);
+    plant_sync(p, shift, word, errors);
+    planted[n_planted++] = p;
+
+    ok &= compare_scans(name, nstarts, 0);
+    ok &= compare_scans(name, nstarts, 1);
+
+    n = sync_scan(nstarts, 0, cands, MAX_CANDIDATES, &end);
+    for (i = 0; i < n_planted && ok; ++i) {
+        int16_t center;
+        int should_find = (errors <= MAX_SYNC_ERRORS && planted[i] < nstarts);
+        int found = 0, j;
+
+        for (j = 0; j < n; ++j)
+            if (cands[j].startbit == planted[i] && cands[j].index == planted[i] * 2 + shift && cands[j].type == type)
+                found = 1;
+
+        if (found != should_find) {
+            fprintf(stderr, "%s: FAIL: word at %d %s\n", name, planted[i], found ? "found" : "not found");
+            ok = 0;
+        } else if (check_sync_word(dphi + planted[i] * 2 + shift, word, &center) != (errors <= MAX_SYNC_ERRORS)) {
+            fprintf(stderr, "%s: FAIL: check_sync_word disagrees about the word at %d\n", name, planted[i]);
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        fprintf(stderr, "%s: PASS\n", name);
+    return ok;
+}
+
+// demod_uplink_blocks slices an uplink frame straight into deinterleaved
+// blocks (with SIMD where available); it must give the same blocks as
+// slicing to bytes with demod_frame and then deinterleaving, as
+// correct_uplink_frame does. 'range' limits the values so that some equal
+// the threshold; 'offset' varies the alignment of the loads.
+static int test_uplink_blocks(int range, int offset, int16_t center)
+{
+    static uint8_t frame[UPLINK_FRAME_BYTES];
+    static uint8_t expected[UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+    static uint8_t got[UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+    int block, i;
+
+    for (i = 0; i < SYNC_SCAN_MAX_SAMPLES; ++i)
+        dphi[i] = (range ? (int) (lcg_next() % (2 * range + 1)) - range : (int16_t) lcg_next());
+
+    demod_frame(dphi + offset, frame, UPLINK_FRAME_BYTES, center);
+    for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block)
+        for (i = 0; i < UPLINK_BLOCK_BYTES; ++i)
+            expected[block][i] = frame[i * UPLINK_FRAME_BLOCKS + block];
+
+    memset(got, 0, sizeof(got));
+    demod_uplink_blocks(dphi + offset, got, center);
+
+    for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block) {
+        for (i = 0; i < UPLINK_BLOCK_BYTES; ++i) {
+            if (got[block][i] != expected[block][i]) {
+                fprintf(stderr, "uplink blocks, range %d, offset %d, center %d: FAIL: block %d byte %d: expected %02x, got %02x\n",
+                        range, offset, center, block, i, expected[block][i], got[block][i]);
+                return 0;
+            }
+        }
+    }
+
+    fprintf(stderr, "uplink blocks, range %d, offset %d, center %d: PASS\n", range, offset, center);
+    return 1;
+}
+
+// The squelch folds each block of the stream into the noise floor once,
+// so splitting the same stream into different search buffers must give
+// the same floor, the same per-block decisions and the same counts of
+// searched and skipped start samples.
+
+#define STREAM_SAMPLES (1 << 19)
+#define STREAM_STARTS ((STREAM_SAMPLES - SYNC_SCAN_MAX_SAMPLES) / 2)
+
+static int16_t stream_dphi[STREAM_SAMPLES];
+static uint32_t stream_energy[STREAM_SAMPLES];
+
+// noise with bursts of signal of varying strength
+static void make_stream(void)
+{
+    static uint16_t iq[STREAM_SAMPLES];
+    int i, amplitude = 2;
+
+    for (i = 0; i < STREAM_SAMPLES; ++i) {
+        int di, dq;
+
+        if (i % 1000 == 0)
+            amplitude = (lcg_next() % 5 == 0 ? 20 + lcg_next() % 100 : 2 + lcg_next() % 3);
+
+        di = (int) (lcg_next() % (2 * amplitude + 1)) - amplitude;
+        dq = (int) (lcg_next() % (2 * amplitude + 1)) - amplitude;
+        iq[i] = (uint16_t) ((127 + di) | (127 + dq) << 8);
+        stream_dphi[i] = (int16_t) lcg_next();
+    }
+
+    accumulate_energy(stream_energy, iq, STREAM_SAMPLES, 0);
+}
+
+// Search the first STREAM_STARTS start positions of the stream in buffers
+// of 'nstarts' starts each, or of random sizes if 'nstarts' is 0
+static void squelch_stream(struct squelch *squelch, int nstarts)
+{
+    static struct sync_scan scan;
+    struct sync_candidate cand;
+    int pos = 0;
+
+    squelch_init(squelch, 1, 6.0f);
+    while (pos < STREAM_STARTS) {
+        int n = (nstarts ? nstarts : 1 + (int) (lcg_next() % NSTARTS_MAX));
+
+        if (n > STREAM_STARTS - pos)
+            n = STREAM_STARTS - pos;
+
+        sync_scan_init(&scan, stream_dphi + pos * 2, stream_energy + pos * 2, pos * 2, n, squelch);
+        while (sync_scan_next(&scan, &cand))
+            ;
+        pos += n;
+    }
+}
+
+static int test_squelch_split(const struct squelch *expected, int nstarts)
+{
+    static struct squelch got;
+    char name[64];
+
+    if (nstarts)
+        snprintf(name, sizeof(name), "squelch, buffers of %d starts", nstarts);
+    else
+        snprintf(name, sizeof(name), "squelch, buffers of random sizes");
+
+    squelch_stream(&got, nstarts);
+
+    if (got.floor != expected->floor || got.next != expected->next) {
+        fprintf(stderr, "%s: FAIL: expected floor %f up to %llu, got %f up to %llu\n", name,
+                expected->floor, (unsigned long long) expected->next, got.floor, (unsigned long long) got.next);
+        return 0;
+    }
+
+    if (memcmp(got.open, expected->open, sizeof(got.open)) != 0 ||
+        memcmp(got.block_floor, expected->block_floor, sizeof(got.block_floor)) != 0) {
+        fprintf(stderr, "%s: FAIL: per-block decisions differ\n", name);
+        return 0;
+    }
+
+    if (got.searched != expected->searched || got.skipped != expected->skipped) {
+        fprintf(stderr, "%s: FAIL: expected %llu searched / %llu skipped, got %llu / %llu\n", name,
+                (unsigned long long) expected->searched, (unsigned long long) expected->skipped,
+                (unsigned long long) got.searched, (unsigned long long) got.skipped);
+        return 0;
+    }
+
+    fprintf(stderr, "%s: PASS\n", name);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    static const int nstarts[] = { 1, 63, 64, 6400 + 37, NSTARTS_MAX };
+    int all_ok = 1;
+    int s, errors, type, shift, offset;
+
+    for (s = 0; s < sizeof(nstarts) / sizeof(nstarts[0]); ++s)
+        for (errors = 0; errors <= MAX_SYNC_ERRORS + 1; ++errors)
+            for (type = FRAME_ADSB; type <= FRAME_UPLINK; ++type)
+                for (shift = 0; shift < 2; ++shift) {
+                    all_ok &= test_sync_scan(nstarts[s], errors, type, shift, 1);
+                    all_ok &= test_sync_scan(nstarts[s], errors, type, shift, 0);
+                }
+
+    for (offset = 0; offset < 4; ++offset) {
+        all_ok &= test_uplink_blocks(0, offset, 0);
+        all_ok &= test_uplink_blocks(0, offset, -12345);
+        all_ok &= test_uplink_blocks(0, offset, 32767);
+        all_ok &= test_uplink_blocks(0, offset, -32768);
+        all_ok &= test_uplink_blocks(3, offset, 0);
+        all_ok &= test_uplink_blocks(3, offset, 2);
+    }
+
+    {
+        static struct squelch reference;
+        static const int splits[] = { 1, 37, 64, 1000, 4096 + 3, NSTARTS_MAX, 0, 0 };
+
+        make_stream();
+        squelch_stream(&reference, 4096);
+        if (reference.searched == 0 || reference.skipped == 0) {
+            fprintf(stderr, "squelch: FAIL: stream is all %s\n", reference.searched ? "searched" : "skipped");
+            all_ok = 0;
+        }
+
+        for (s = 0; s < sizeof(splits) / sizeof(splits[0]); ++s)
+            all_ok &= test_squelch_split(&reference, splits[s]);
+    }
+
+    return all_ok ? 0 : 1;
+}
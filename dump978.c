@@ -21,489 +21,931 @@
 #include <string.h>
 #include <math.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #include "uat.h"
 #include "fec.h"
-
-static void make_atan2_table();
-static void read_from_stdin();
-static int check_sync_word(uint16_t *phi, uint64_t pattern, int16_t *center);
-static int process_buffer(uint16_t *phi, uint16_t *raw, int len, uint64_t offset);
-static int demod_adsb_frame(uint16_t *phi, uint8_t *to, int *rs_errors);
-static int demod_uplink_frame(uint16_t *phi, uint8_t *to, int *rs_errors);
-static void demod_frame(uint16_t *phi, uint8_t *frame, int bytes, int16_t center_dphi);
-static void handle_adsb_frame(uint64_t timestamp, uint8_t *frame, int rs, float signal_strength);
-static void handle_uplink_frame(uint64_t timestamp, uint8_t *frame, int rs, float signal_strength);
-
-#define SYNC_BITS (36)
-#define ADSB_SYNC_WORD   0xEACDDA4E2UL
-#define UPLINK_SYNC_WORD 0x153225B1DUL
-
-// relying on signed overflow is theoretically bad. Let's do it properly.
-
-#ifdef USE_SIGNED_OVERFLOW
-#define phi_difference(from,to) ((int16_t)((to) - (from)))
-#else
-inline int16_t phi_difference(uint16_t from, uint16_t to)
+#include "frontend.h"
+#include "demod.h"
+#include "pipeline.h"
+#include "ring.h"
+#include "server.h"
+#include "writer.h"
+#include "stats.h"
+#include "arrival.h"
+
+static void demodulate(input_fn_t input);
+static void demodulate_single(input_fn_t input);
+static ssize_t read_from_stdin(void *buf, size_t len);
+static int run_benchmark(void);
+static int process_buffer(int16_t *dphi, uint32_t *energy, int len, uint64_t offset);
+static void handle_frame(uint64_t timestamp, const struct demod_result *frame);
+static void output_flush(void);
+static void output_frame_done(void);
+static void report_latency(double now);
+static void check_latency_report(double now);
+static void report_drops(void);
+static double monotonic_seconds(void);
+
+static discriminator_t discriminator = DISCRIMINATOR_TABLE;
+static int benchmark = 0;
+static int workers = 0;
+static int fec_retries = 0;
+static int output_binary = 0;
+static int net_port = 0;
+static const char *stats_file = NULL;
+static int stats_interval = 10;
+static size_t output_queue = 0;    // bytes; 0 to write synchronously
+static writer_drop_t output_drop = WRITER_DROP_OLDEST;
+
+// With --output-queue, frames dropped from the queue are reported on
+// stderr at most every DROP_REPORT_INTERVAL seconds while it happens, and
+// in total at exit
+#define DROP_REPORT_INTERVAL 10
+
+static double last_drop_report;
+static uint64_t reported_drops;    // frames_dropped as of the last report
+
+// Output is formatted into output_buf and written to stdout with a
+// single write() when the flush policy says so, or when there might
+// not be room for another frame.
+typedef enum { FLUSH_FRAME, FLUSH_INTERVAL, FLUSH_FULL } flush_policy_t;
+
+#define OUTPUT_BUFFER_SIZE 65536
+#define OUTPUT_FRAME_MAX 1024 // longest formatted frame, with room to spare
+
+static flush_policy_t flush_policy = FLUSH_FRAME;
+static double flush_interval;   // seconds, for FLUSH_INTERVAL
+static double last_flush;
+static char output_buf[OUTPUT_BUFFER_SIZE];
+static size_t output_used;
+static unsigned output_frames;  // frames in output_buf
+
+// Frame timing (see arrival.h). Only input from stdin is timed.
+static int emit_timestamps = 0;
+static int latency_interval = 0;    // seconds between latency reports; 0 for none
+
+// The frame being output, set by handle_frame()
+static double frame_arrival;        // when its last sample arrived
+static double frame_buffering;      // its buffering latency, or NAN if unknown
+
+// Histograms of the latency of frames output since the last report, in
+// power-of-two millisecond buckets: [0,1), [1,2), [2,4), ...
+#define LATENCY_BUCKETS 16
+
+struct latency_histogram {
+    unsigned count[LATENCY_BUCKETS];
+    unsigned frames;
+    double total;
+    double max;
+};
+
+// buffering: from when the last sample of the frame was due, going by
+// the sample rate and the first read, to when it arrived
+// processing: from its arrival until the frame was written (or queued)
+//
+// Frames are added by the output side when it flushes, but a report may
+// also be printed by the input side (so that reports keep coming while no
+// frames are output), so the histograms are guarded by latency_lock.
+static struct latency_histogram buffering_latency, processing_latency;
+static double last_latency_report;
+static pthread_mutex_t latency_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// per frame in output_buf: arrival of its last sample, and its buffering
+// latency (NAN if unknown)
+static double output_arrival[OUTPUT_BUFFER_SIZE / 32];
+static double output_buffering[OUTPUT_BUFFER_SIZE / 32];
+static struct squelch squelch;
+
+// stream offset where process_buffer() resumes its search
+static uint64_t search_resume;
+
+// frames demodulated so far
+static unsigned adsb_frames;
+static unsigned uplink_frames;
+
+static void usage(const char *argv0)
 {
-    int32_t difference = to - from; // lies in the range -65535 .. +65535
-    if (difference >= 32768)        //   +32768..+65535
-        return difference - 65536;  //   -> -32768..-1: always in range
-    else if (difference < -32768)   //   -65535..-32769
-        return difference + 65536;  //   -> +1..32767: always in range
-    else
-        return difference;
+    fprintf(stderr,
+            "Usage: %s [options] < samples\n"
+            "\n"
+            "Reads 8-bit unsigned I/Q samples at 2.083334MHz from stdin and writes\n"
+            "demodulated UAT messages to stdout.\n"
+            "\n"
+            "Options:\n"
+            "  --discriminator <table|direct>\n"
+            "        FM discriminator to use:\n"
+            "          table   phase lookup table (default)\n"
+            "          direct  table-free cross product and polynomial atan2\n"
+            "  --squelch <dB>\n"
+            "        only search for sync words where the signal power is at\n"
+            "        least <dB> above the running noise floor (default: search\n"
+            "        everywhere); reports the fraction of samples skipped\n"
+            "  --format <text|binary>\n"
+            "        output format:\n"
+            "          text    one line of hex per frame (default)\n"
+            "          binary  compact binary records (see uat.h); the\n"
+            "                  uat2* tools accept either\n"
+            "  --flush <frame|full|ms>\n"
+            "        when to write buffered output:\n"
+            "          frame   after every frame, for the lowest latency (default)\n"
+            "          full    only when the output buffer is full\n"
+            "          <ms>    when a frame is output at least <ms> milliseconds\n"
+            "                  after the last write, or input is read (without\n"
+            "                  --workers) after that long\n"
+            "  --output-queue <KB>\n"
+            "        write stdout from a separate thread, through a queue of\n"
+            "        up to <KB> kilobytes (at least 128), so that a slow reader\n"
+            "        can't stall demodulation; when the queue is full, output\n"
+            "        is dropped, and the number of frames dropped is reported\n"
+            "        every %d seconds while that happens and at exit (default:\n"
+            "        write directly, and wait for the reader)\n"
+            "  --output-drop <oldest|newest>\n"
+            "        with --output-queue, what to drop when the queue is full\n"
+            "        (default: oldest)\n"
+            "  --timestamps\n"
+            "        add the time of the start of each frame to the output, as\n"
+            "        ;t=<seconds since the epoch>, from its sample offset and the\n"
+            "        time the input started (text output only: binary records\n"
+            "        carry the sample offset instead)\n"
+            "  --latency-report <seconds>\n"
+            "        every <seconds>, report on stderr histograms of how long\n"
+            "        frames took from when their last sample was due to its\n"
+            "        arrival, and from its arrival until the frame was output\n"
+            "  --stats-file <path>\n"
+            "        periodically write performance counters (input, squelch,\n"
+            "        sync candidates, rejections, FEC results, output queue\n"
+            "        drops and the time spent in each stage) to <path> as\n"
+            "        JSON; the same counters are written to stderr on SIGUSR1\n"
+            "        in any case\n"
+            "  --stats-interval <seconds>\n"
+            "        how often to write the --stats-file (default: 10)\n"
+            "  --net-port <port>\n"
+            "        also serve the output (in the same format) to any number\n"
+            "        of clients connecting to this TCP port; clients that fall\n"
+            "        too far behind are disconnected\n"
+            "  --fec-retries <n>\n"
+            "        when error correction fails, retry up to <n> times with\n"
+            "        the least reliable bytes marked as erasures; recovers more\n"
+            "        weak frames at the cost of CPU time (default: 0, off)\n"
+            "  --workers <n>\n"
+            "        run input, phase conversion and sync search on separate\n"
+            "        threads, with <n> demodulator/FEC threads; 0 (the default)\n"
+            "        runs everything on one thread\n"
+            "  --benchmark\n"
+            "        read all of stdin into memory, then report throughput\n"
+            "        and decode counts of each discriminator on stderr\n"
+            "  --help\n"
+            "        show this help\n",
+            argv0, DROP_REPORT_INTERVAL);
 }
-#endif
 
 int main(int argc, char **argv)
 {
-    make_atan2_table();
-    init_fec();
-    read_from_stdin();
+    static const struct option long_options[] = {
+        { "discriminator", required_argument, NULL, 'd' },
+        { "benchmark",     no_argument,       NULL, 'b' },
+        { "workers",       required_argument, NULL, 'w' },
+        { "squelch",       required_argument, NULL, 's' },
+        { "fec-retries",   required_argument, NULL, 'f' },
+        { "format",        required_argument, NULL, 'o' },
+        { "flush",         required_argument, NULL, 'F' },
+        { "net-port",      required_argument, NULL, 'p' },
+        { "output-queue",  required_argument, NULL, 'q' },
+        { "output-drop",   required_argument, NULL, 'D' },
+        { "timestamps",    no_argument,       NULL, 't' },
+        { "latency-report", required_argument, NULL, 'L' },
+        { "stats-file",    required_argument, NULL, 'S' },
+        { "stats-interval", required_argument, NULL, 'I' },
+        { "help",          no_argument,       NULL, 'h' },
+        { NULL,            0,                 NULL, 0 }
+    };
+    int opt;
+
+    squelch_init(&squelch, 0, 0);
+
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'd':
+            if (!strcmp(optarg, "table"))
+                discriminator = DISCRIMINATOR_TABLE;
+            else if (!strcmp(optarg, "direct"))
+                discriminator = DISCRIMINATOR_DIRECT;
+            else {
+                fprintf(stderr, "%s: unknown discriminator '%s'\n", argv[0], optarg);
+                return 1;
+            }
+            break;
+        case 'b':
+            benchmark = 1;
+            break;
+        case 'w':
+            workers = atoi(optarg);
+            if (workers < 0 || workers > PIPELINE_MAX_WORKERS) {
+                fprintf(stderr, "%s: --workers must be between 0 and %d\n", argv[0], PIPELINE_MAX_WORKERS);
+                return 1;
+            }
+            break;
+        case 's':
+            squelch_init(&squelch, 1, atof(optarg));
+            break;
+        case 'f':
+            fec_retries = atoi(optarg);
+            if (fec_retries < 0) {
+                fprintf(stderr, "%s: --fec-retries must not be negative\n", argv[0]);
+                return 1;
+            }
+            break;
+        case 'o':
+            if (!strcmp(optarg, "text"))
+                output_binary = 0;
+            else if (!strcmp(optarg, "binary"))
+                output_binary = 1;
+            else {
+                fprintf(stderr, "%s: unknown output format '%s'\n", argv[0], optarg);
+                return 1;
+            }
+            break;
+        case 'F':
+            if (!strcmp(optarg, "frame"))
+                flush_policy = FLUSH_FRAME;
+            else if (!strcmp(optarg, "full"))
+                flush_policy = FLUSH_FULL;
+            else if (atoi(optarg) > 0) {
+                flush_policy = FLUSH_INTERVAL;
+                flush_interval = atoi(optarg) / 1000.0;
+            } else {
+                fprintf(stderr, "%s: unknown flush policy '%s'\n", argv[0], optarg);
+                return 1;
+            }
+            break;
+        case 'p':
+            net_port = atoi(optarg);
+            if (net_port <= 0 || net_port > 65535) {
+                fprintf(stderr, "%s: bad --net-port '%s'\n", argv[0], optarg);
+                return 1;
+            }
+            break;
+        case 'q':
+            if (atoi(optarg) < WRITER_MIN_QUEUE / 1024) {
+                fprintf(stderr, "%s: --output-queue must be at least %d\n", argv[0], WRITER_MIN_QUEUE / 1024);
+                return 1;
+            }
+            output_queue = (size_t) atoi(optarg) * 1024;
+            break;
+        case 'D':
+            if (!strcmp(optarg, "oldest"))
+                output_drop = WRITER_DROP_OLDEST;
+            else if (!strcmp(optarg, "newest"))
+                output_drop = WRITER_DROP_NEWEST;
+            else {
+                fprintf(stderr, "%s: unknown --output-drop policy '%s'\n", argv[0], optarg);
+                return 1;
+            }
+            break;
+        case 't':
+            emit_timestamps = 1;
+            break;
+        case 'L':
+            latency_interval = atoi(optarg);
+            if (latency_interval <= 0) {
+                fprintf(stderr, "%s: --latency-report must be a positive number of seconds\n", argv[0]);
+                return 1;
+            }
+            break;
+        case 'S':
+            stats_file = optarg;
+            break;
+        case 'I':
+            stats_interval = atoi(optarg);
+            if (stats_interval <= 0) {
+                fprintf(stderr, "%s: --stats-interval must be a positive number of seconds\n", argv[0]);
+                return 1;
+            }
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind < argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (emit_timestamps && output_binary) {
+        fprintf(stderr, "%s: --timestamps needs text output; binary records carry the sample offset instead\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (benchmark)
+        return run_benchmark();
+
+    // first, so that every other thread blocks SIGUSR1
+    if (stats_start(stats_file, stats_interval) < 0) {
+        perror("stats_start");
+        return 1;
+    }
+
+    if (net_port && server_start(net_port) < 0) {
+        fprintf(stderr, "%s: can't listen on port %d: %s\n", argv[0], net_port, strerror(errno));
+        return 1;
+    }
+
+    if (output_queue && writer_start(1, output_queue, output_drop) < 0) {
+        perror("writer_start");
+        return 1;
+    }
+
+    last_flush = last_latency_report = last_drop_report = monotonic_seconds();
+    demodulate(read_from_stdin);
+    output_flush();
+    if (latency_interval && processing_latency.frames)
+        report_latency(monotonic_seconds());
+
+    if (net_port)
+        server_stop();
+
+    if (output_queue) {
+        struct writer_stats ws;
+        writer_stop(&ws);
+        if (ws.frames_dropped)
+            fprintf(stderr, "output queue: dropped %llu of %llu frames (%llu bytes)\n",
+                    (unsigned long long) ws.frames_dropped,
+                    (unsigned long long) (ws.frames_written + ws.frames_dropped),
+                    (unsigned long long) ws.bytes_dropped);
+    }
+
+    stats_stop();
+
+    if (squelch.enabled) {
+        uint64_t total = squelch.searched + squelch.skipped;
+        fprintf(stderr, "squelch: skipped %llu of %llu samples (%.1f%%)\n",
+                (unsigned long long) squelch.skipped, (unsigned long long) total,
+                total ? 100.0 * squelch.skipped / total : 0.0);
+    }
+
     return 0;
 }
 
-static void dump_raw_message(char updown, uint8_t *data, int len, int rs_errors, float signal_strength)
+static void latency_add(struct latency_histogram *h, double seconds)
 {
-    int i;
+    double ms = seconds * 1000;
+    int bucket = 0;
+
+    if (ms < 0)
+        ms = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && ms >= (1 << bucket))
+        ++bucket;
+
+    ++h->count[bucket];
+    ++h->frames;
+    h->total += ms;
+    if (ms > h->max)
+        h->max = ms;
+}
 
-    fprintf(stdout, "%c", updown);
-    for (i = 0; i < len; ++i) {
-        fprintf(stdout, "%02x", data[i]);
+// Print "%10.1f" of the mean of histogram 'h', or a dash if it is empty
+static void print_latency_mean(const struct latency_histogram *h)
+{
+    if (h->frames)
+        fprintf(stderr, " %10.1f", h->total / h->frames);
+    else
+        fprintf(stderr, " %10s", "-");
+}
+
+// Print the latency histograms and start new ones. The caller must hold
+// latency_lock, or be the only thread left.
+static void report_latency(double now)
+{
+    int i, last = 0;
+
+    for (i = 0; i < LATENCY_BUCKETS; ++i)
+        if (buffering_latency.count[i] || processing_latency.count[i])
+            last = i;
+
+    fprintf(stderr, "latency of %u frames:\n", processing_latency.frames);
+    fprintf(stderr, "  %-13s %10s %10s\n", "ms", "buffering", "processing");
+    for (i = 0; i <= last; ++i) {
+        char range[32];
+        if (i == 0)
+            snprintf(range, sizeof(range), "<1");
+        else if (i == LATENCY_BUCKETS - 1)
+            snprintf(range, sizeof(range), ">=%d", 1 << (i - 1));
+        else
+            snprintf(range, sizeof(range), "%d-%d", 1 << (i - 1), 1 << i);
+        fprintf(stderr, "  %-13s %10u %10u\n", range, buffering_latency.count[i], processing_latency.count[i]);
     }
+    fprintf(stderr, "  %-13s", "mean");
+    print_latency_mean(&buffering_latency);
+    print_latency_mean(&processing_latency);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  %-13s %10.1f %10.1f\n", "max", buffering_latency.max, processing_latency.max);
+
+    memset(&buffering_latency, 0, sizeof(buffering_latency));
+    memset(&processing_latency, 0, sizeof(processing_latency));
+    last_latency_report = now;
+}
 
-    fprintf(stdout, ";ss=%.2f", signal_strength);
+// Print the latency report if one is due
+static void check_latency_report(double now)
+{
+    pthread_mutex_lock(&latency_lock);
+    if (now - last_latency_report >= latency_interval)
+        report_latency(now);
+    pthread_mutex_unlock(&latency_lock);
+}
 
-    if (rs_errors)
-        fprintf(stdout, ";rs=%d", rs_errors);
-    fprintf(stdout, ";\n");
+// Write out everything in output_buf, to stdout (or the output queue)
+// and any network clients
+static void output_flush(void)
+{
+    size_t done = 0;
+    double now;
+
+    if (net_port && output_used > 0)
+        server_send(output_buf, output_used);
+
+    if (output_queue) {
+        if (output_used > 0)
+            writer_push(output_buf, output_used, output_frames);
+        done = output_used;
+    }
+
+    while (done < output_used) {
+        ssize_t n = write(1, output_buf + done, output_used - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break; // non-blocking stdout is full; drop the rest
+            // anything else (EPIPE, EBADF, ENOSPC, ...) won't go away
+            perror("write");
+            exit(1);
+        }
+        done += n;
+    }
+
+    now = monotonic_seconds();
+    if (latency_interval) {
+        unsigned i;
+
+        pthread_mutex_lock(&latency_lock);
+        for (i = 0; i < output_frames; ++i) {
+            if (!isnan(output_buffering[i]))
+                latency_add(&buffering_latency, output_buffering[i]);
+            latency_add(&processing_latency, now - output_arrival[i]);
+        }
+        if (now - last_latency_report >= latency_interval)
+            report_latency(now);
+        pthread_mutex_unlock(&latency_lock);
+    }
+
+    output_used = output_frames = 0;
+    last_flush = now;
 }
 
-static void handle_adsb_frame(uint64_t timestamp, uint8_t *frame, int rs, float signal_strength)
+// Called after each frame is added to output_buf
+static void output_frame_done(void)
 {
-    dump_raw_message('-', frame, (frame[0]>>3) == 0 ? SHORT_FRAME_DATA_BYTES : LONG_FRAME_DATA_BYTES, rs,
-                     signal_strength);
-    fflush(stdout);
+    output_arrival[output_frames] = frame_arrival;
+    output_buffering[output_frames] = frame_buffering;
+    ++output_frames;
+    if (flush_policy == FLUSH_FRAME)
+        output_flush();
+    else if (flush_policy == FLUSH_INTERVAL && monotonic_seconds() - last_flush >= flush_interval)
+        output_flush();
 }
 
-static void handle_uplink_frame(uint64_t timestamp, uint8_t *frame, int rs, float signal_strength)
+// Return space for a formatted frame of up to OUTPUT_FRAME_MAX bytes at
+// the end of output_buf, flushing first if necessary.
+static char *output_reserve(void)
 {
-    dump_raw_message('+', frame, UPLINK_FRAME_DATA_BYTES, rs, signal_strength);
-    fflush(stdout);
+    if (OUTPUT_BUFFER_SIZE - output_used < OUTPUT_FRAME_MAX)
+        output_flush();
+    return output_buf + output_used;
 }
 
-static uint16_t iqphase[65536]; // contains value [0..65536) -> [0, 2*pi)
-static uint16_t iqmagnitude[65536];
+// Two hex digits for each byte value
+#define HEX_ROW(h) \
+    { h, '0' }, { h, '1' }, { h, '2' }, { h, '3' }, { h, '4' }, { h, '5' }, { h, '6' }, { h, '7' }, \
+    { h, '8' }, { h, '9' }, { h, 'a' }, { h, 'b' }, { h, 'c' }, { h, 'd' }, { h, 'e' }, { h, 'f' }
 
-void make_atan2_table()
+static const char hex_table[256][2] = {
+    HEX_ROW('0'), HEX_ROW('1'), HEX_ROW('2'), HEX_ROW('3'), HEX_ROW('4'), HEX_ROW('5'), HEX_ROW('6'), HEX_ROW('7'),
+    HEX_ROW('8'), HEX_ROW('9'), HEX_ROW('a'), HEX_ROW('b'), HEX_ROW('c'), HEX_ROW('d'), HEX_ROW('e'), HEX_ROW('f')
+};
+
+// Write a frame as a binary record; see uat.h for the layout
+static void dump_binary_message(char updown, uint64_t timestamp, const uint8_t *data, int len, int rs_errors,
+                                float signal_strength, float noise_floor)
 {
-    unsigned i,q;
-    union {
-        uint8_t iq[2];
-        uint16_t iq16;
-    } u;
-
-    float fI, fQ, magsq;
-    double d_i, d_q, ang, scaled_ang;
-    for (i = 0; i < 256; ++i) {
-        d_i = (i - 127.5);
-        for (q = 0; q < 256; ++q) {
-            d_q = (q - 127.5);
-            ang = atan2(d_q, d_i) + M_PI; // atan2 returns [-pi..pi], normalize to [0..2*pi]
-            scaled_ang = round(32768 * ang / M_PI);
-
-            u.iq[0] = i;
-            u.iq[1] = q;
-            iqphase[u.iq16] = (scaled_ang < 0 ? 0 : scaled_ang > 65535 ? 65535 : (uint16_t)scaled_ang);
-
-            // calculate magnitude lookup table
-            fI = d_i / 127.5;
-            fQ = d_q / 127.5;
-            magsq = fI * fI + fQ * fQ;
-            if (magsq > 1)
-                magsq = 1;
-
-            iqmagnitude[u.iq16] = (uint16_t) roundf(sqrtf(magsq) * 65535.0f);
-        }
-    }
+    uint8_t *record = (uint8_t *) output_reserve();
+    int ss = (int) lrintf(signal_strength * 100);
+    int snr = isnan(noise_floor) ? RECORD_SNR_UNKNOWN : (int) lrintf((signal_strength - noise_floor) * 10);
+    int i;
+
+    if (ss < -32768)
+        ss = -32768;
+    if (ss > 32767)
+        ss = 32767;
+    if (snr < -32767)
+        snr = -32767;
+    if (snr > 32767)
+        snr = 32767;
+
+    record[0] = RECORD_MAGIC;
+    record[1] = updown;
+    record[2] = len & 0xFF;
+    record[3] = len >> 8;
+    for (i = 0; i < 8; ++i)
+        record[4+i] = (timestamp >> (i * 8)) & 0xFF;
+    record[12] = ss & 0xFF;
+    record[13] = (ss >> 8) & 0xFF;
+    record[14] = snr & 0xFF;
+    record[15] = (snr >> 8) & 0xFF;
+    record[16] = rs_errors > 255 ? 255 : rs_errors;
+    memcpy(record + RECORD_HEADER_BYTES, data, len);
+
+    output_used += RECORD_HEADER_BYTES + len;
 }
 
-static void convert_to_phi(uint16_t *dest, uint16_t *src, int n)
+static void dump_raw_message(char updown, uint64_t timestamp, const uint8_t *data, int len, int rs_errors,
+                             float signal_strength, float noise_floor)
 {
+    char *start, *p;
     int i;
 
-    // unroll the loop. n is always > 2048, usually 36864
-    for (i = 0; i+8 <= n; i += 8) {
-        dest[i] = iqphase[src[i]];
-        dest[i+1] = iqphase[src[i+1]];
-        dest[i+2] = iqphase[src[i+2]];
-        dest[i+3] = iqphase[src[i+3]];
-        dest[i+4] = iqphase[src[i+4]];
-        dest[i+5] = iqphase[src[i+5]];
-        dest[i+6] = iqphase[src[i+6]];
-        dest[i+7] = iqphase[src[i+7]];
+    if (output_binary) {
+        dump_binary_message(updown, timestamp, data, len, rs_errors, signal_strength, noise_floor);
+        output_frame_done();
+        return;
     }
-    for (; i < n; ++i)
-        dest[i] = iqphase[src[i]];
+
+    start = p = output_reserve();
+    *p++ = updown;
+    for (i = 0; i < len; ++i) {
+        memcpy(p, hex_table[data[i]], 2);
+        p += 2;
+    }
+
+    // the trailer is short enough that snprintf can't run out of room
+    p += snprintf(p, OUTPUT_FRAME_MAX - (p - start), ";ss=%.2f", signal_strength);
+    if (!isnan(noise_floor))
+        p += snprintf(p, OUTPUT_FRAME_MAX - (p - start), ";snr=%.1f", signal_strength - noise_floor);
+
+    if (rs_errors)
+        p += snprintf(p, OUTPUT_FRAME_MAX - (p - start), ";rs=%d", rs_errors);
+    if (emit_timestamps)
+        p += snprintf(p, OUTPUT_FRAME_MAX - (p - start), ";t=%.6f", arrival_wall_time(timestamp));
+    *p++ = ';';
+    *p++ = '\n';
+
+    output_used += p - start;
+    output_frame_done();
 }
 
-// returns average signal strength (dBFS) of receiver on all samples in measurement.
-static float calc_power(uint16_t *samples, unsigned int len)
+static void handle_adsb_frame(uint64_t timestamp, const uint8_t *frame, int rs, float signal_strength,
+                              float noise_floor)
 {
-    uint16_t *in = samples;
-    unsigned int i, nsamples = len;
-    uint64_t power = 0;
-    uint32_t mag;
+    ++adsb_frames;
+    if (benchmark)
+        return;
 
-    // unroll this a bit
-    for (i = 0; i < (nsamples>>3); ++i) {
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+    dump_raw_message('-', timestamp, frame, (frame[0]>>3) == 0 ? SHORT_FRAME_DATA_BYTES : LONG_FRAME_DATA_BYTES, rs,
+                     signal_strength, noise_floor);
+}
 
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+static void handle_uplink_frame(uint64_t timestamp, const uint8_t *frame, int rs, float signal_strength,
+                                float noise_floor)
+{
+    ++uplink_frames;
+    if (benchmark)
+        return;
 
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+    dump_raw_message('+', timestamp, frame, UPLINK_FRAME_DATA_BYTES, rs, signal_strength, noise_floor);
+}
 
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+static void handle_frame(uint64_t timestamp, const struct demod_result *frame)
+{
+    uint64_t start = stats_ticks();
 
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+    if (latency_interval) {
+        uint64_t end = timestamp + frame->bits * 2;
 
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+        if (arrival_started()) {
+            frame_arrival = arrival_time(end);
+            frame_buffering = arrival_buffering(end, frame_arrival);
+        } else {
+            frame_arrival = monotonic_seconds(); // not reading from stdin
+            frame_buffering = NAN;
+        }
+    }
 
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+    if (frame->type == FRAME_ADSB)
+        handle_adsb_frame(timestamp, frame->data, frame->rs_errors, frame->signal_strength, frame->noise_floor);
+    else
+        handle_uplink_frame(timestamp, frame->data, frame->rs_errors, frame->signal_strength, frame->noise_floor);
 
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+    stats_stage_done(STAGE_OUTPUT, start);
+}
+
+static ssize_t read_from_stdin(void *buf, size_t len)
+{
+    ssize_t n = read(0, buf, len);
+
+    if (n > 0) {
+        STATS_ADD(reads, 1);
+        STATS_ADD(read_bytes, n);
+        STATS_MAX(max_read, n);
     }
 
-    for (i = 0; i < (nsamples&7); ++i) {
-        mag = iqmagnitude[*in++];
-        power += mag * mag;
+    if (n > 0 && (emit_timestamps || latency_interval)) {
+        struct timespec ts;
+        double now = monotonic_seconds();
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        arrival_record(n, now, ts.tv_sec + ts.tv_nsec / 1e9);
+
+        // keep reporting while no frames are being output
+        if (latency_interval)
+            check_latency_report(now);
+    }
+
+    if (output_queue)
+        report_drops();
+
+    return n;
+}
+
+// Report frames dropped from the output queue since the last report.
+// Called after each read of input, which carries on even when the output
+// has stalled.
+static void report_drops(void)
+{
+    struct writer_stats ws;
+    double now = monotonic_seconds();
+
+    if (now - last_drop_report < DROP_REPORT_INTERVAL)
+        return;
+
+    writer_get_stats(&ws);
+    if (ws.frames_dropped != reported_drops) {
+        fprintf(stderr, "output queue: dropped %llu frames in the last %.0f seconds (%llu in total)\n",
+                (unsigned long long) (ws.frames_dropped - reported_drops), now - last_drop_report,
+                (unsigned long long) ws.frames_dropped);
+        reported_drops = ws.frames_dropped;
     }
 
-    double out_power = power / (65535.0 * 65535.0 * len);
-    return 10 * log10(out_power);
+    last_drop_report = now;
 }
 
-void read_from_stdin()
+// Read samples from 'input' until EOF or error, demodulating as we go.
+static void demodulate(input_fn_t input)
 {
-    char buffer[65536*2];
-    uint16_t phi[65536];
-    int n;
-    int used = 0;
-    uint64_t offset = 0;
-    
-    while ( (n = read(0, buffer+used, sizeof(buffer)-used)) > 0 ) {
+    if (workers > 0)
+        pipeline_run(input, discriminator, workers, &squelch, fec_retries, handle_frame);
+    else
+        demodulate_single(input);
+}
+
+// Single-threaded demodulator: read, convert and search one buffer at a time.
+//
+// Samples, phase differences and energy totals live in double-mapped rings (see
+// mirror_alloc) indexed by absolute sample offset, so the unprocessed
+// tail left behind by process_buffer() is always contiguous with the
+// next read and never needs to be moved.
+#define SINGLE_BUFFER_SAMPLES 65536
+
+static void demodulate_single(input_fn_t input)
+{
+    const size_t size = SINGLE_BUFFER_SAMPLES * 2;
+    const uint64_t mask = SINGLE_BUFFER_SAMPLES - 1;
+    uint8_t *raw = NULL;
+    int16_t *dphi = NULL;
+    uint32_t *energy = NULL;
+    uint32_t total = 0;
+    ssize_t n;
+    uint64_t offset = 0;       // sample offset of the first unprocessed sample
+    uint64_t end = 0;          // bytes read so far
+    uint64_t converted = 0;    // phase differences / energy totals computed so far
+
+    if (!(raw = mirror_alloc(size)) || !(dphi = mirror_alloc(size)) || !(energy = mirror_alloc(size * 2))) {
+        perror("mirror_alloc");
+        mirror_free(raw, size);
+        mirror_free(dphi, size);
+        return;
+    }
+
+    search_resume = 0;
+    while ( (n = input(raw + (end & (size-1)), size - (end - offset*2))) > 0 ) {
         int processed;
 
-        convert_to_phi(phi + used / 2, (uint16_t *)(buffer + (used & ~1)),
-                       ((used & 1) + n) / 2);
+        end += n;
+
+        // the last sample of the previous read now has a successor,
+        // so continue the phase differences from there
+        if (end/2 > converted + 1) {
+            convert_to_dphi(discriminator, dphi + (converted & mask),
+                            (uint16_t *) raw + (converted & mask),
+                            end/2 - 1 - converted);
+            total = accumulate_energy(energy + (converted & mask),
+                                      (uint16_t *) raw + (converted & mask),
+                                      end/2 - 1 - converted, total);
+            converted = end/2 - 1;
+        }
 
-        used += n;
-        processed = process_buffer(phi, (uint16_t*) buffer, used/2, offset);
-        used -= processed * 2;
+        processed = process_buffer(dphi + (offset & mask), energy + (offset & mask),
+                                   end/2 - offset, offset);
         offset += processed;
-        if (used > 0) {
-            memmove(buffer, buffer+processed*2, used);
-            memmove(phi, phi + processed, used);
-        }
+
+        // don't hold on to output indefinitely while no frames arrive
+        if (flush_policy == FLUSH_INTERVAL && output_used > 0 &&
+            monotonic_seconds() - last_flush >= flush_interval)
+            output_flush();
     }
+
+    mirror_free(raw, size);
+    mirror_free(dphi, size);
+    mirror_free(energy, size * 2);
 }
 
 
-// Return 1 if word is "equal enough" to expected
-static inline int sync_word_fuzzy_compare(uint64_t word, uint64_t expected)
-{
-    uint64_t diff;
-
-    if (word == expected)
-        return 1;
+//
+// Benchmark mode: load a recorded capture into memory, then time the
+// front end alone and the complete demodulator with each discriminator.
+//
 
-    diff = word ^ expected; // guaranteed nonzero
+static uint8_t *bench_data;
+static size_t bench_len;
+static size_t bench_pos;
 
-    // This is a bit-twiddling popcount
-    // hack, tweaked as we only care about
-    // "<N" or ">=N" set bits for fixed N -
-    // so we can bail out early after seeing N
-    // set bits.
-    //
-    // It relies on starting with a nonzero value
-    // with zero or more trailing clear bits
-    // after the last set bit:
-    //
-    //    010101010101010000
-    //                 ^
-    // Subtracting one, will flip the 
-    // bits starting at the last set bit:
-    //
-    //    010101010101001111
-    //                 ^
-    // then we can use that as a bitwise-and 
-    // mask to clear the lowest set bit:
-    //
-    //    010101010101000000
-    //                 ^
-    // And repeat until the value is zero
-    // or we have seen too many set bits.
-    
-    // >= 1 bit
-    diff &= (diff-1);   // clear lowest set bit
-    if (!diff)
-        return 1; // 1 bit error
-
-    // >= 2 bits
-    diff &= (diff-1);   // clear lowest set bit
-    if (!diff)
-        return 1; // 2 bits error
-
-    // >= 3 bits
-    diff &= (diff-1);   // clear lowest set bit
-    if (!diff)
-        return 1; // 3 bits error
-
-    // >= 4 bits
-    diff &= (diff-1);   // clear lowest set bit
-    if (!diff)
-        return 1; // 4 bits error
-
-    // > 4 bits in error, give up
-    return 0;
+static ssize_t read_from_bench(void *buf, size_t len)
+{
+    if (len > bench_len - bench_pos)
+        len = bench_len - bench_pos;
+    memcpy(buf, bench_data + bench_pos, len);
+    bench_pos += len;
+    return len;
 }
 
-#define MAX_SYNC_ERRORS 4
+static double monotonic_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-// check that there is a valid sync word starting at 'phi'
-// that matches the sync word 'pattern'. Place the dphi
-// threshold to use for bit slicing in '*center'. Return 1
-// if the sync word is OK, 0 on failure
-int check_sync_word(uint16_t *phi, uint64_t pattern, int16_t *center)
+static int run_benchmark(void)
 {
+    static const struct {
+        const char *name;
+        discriminator_t discriminator;
+    } methods[] = {
+        { "table",  DISCRIMINATOR_TABLE },
+        { "direct", DISCRIMINATOR_DIRECT },
+        { NULL, 0 }
+    };
+    size_t alloc = 0;
+    ssize_t n;
+    size_t samples;
+    int16_t *dphi;
     int i;
-    int32_t dphi_zero_total = 0;
-    int zero_bits = 0;
-    int32_t dphi_one_total = 0;
-    int one_bits = 0;
-    int error_bits;
 
-    // find mean dphi for zero and one bits;
-    // take the mean of the two as our central value
-
-    for (i = 0; i < SYNC_BITS; ++i) {
-        int16_t dphi = phi_difference(phi[i*2], phi[i*2+1]);
+    // slurp stdin
+    for (;;) {
+        if (bench_len == alloc) {
+            alloc = (alloc ? alloc * 2 : 16 * 1024 * 1024);
+            if (!(bench_data = realloc(bench_data, alloc))) {
+                perror("realloc");
+                return 1;
+            }
+        }
 
-        if (pattern & (1UL << (35-i))) {
-            ++one_bits;
-            dphi_one_total += dphi;
-        } else {
-            ++zero_bits;
-            dphi_zero_total += dphi;
+        n = read(0, bench_data + bench_len, alloc - bench_len);
+        if (n < 0) {
+            perror("read");
+            return 1;
         }
+        if (n == 0)
+            break;
+        bench_len += n;
+    }
+
+    samples = bench_len / 2;
+    if (samples < 2) {
+        fprintf(stderr, "benchmark: no input samples\n");
+        return 1;
+    }
+
+    if (!(dphi = malloc(65536 * sizeof(*dphi)))) {
+        perror("malloc");
+        return 1;
     }
 
-    dphi_zero_total /= zero_bits;
-    dphi_one_total /= one_bits;
+    fprintf(stderr, "benchmark: %zu samples (%.1f seconds at 2.083334MHz), %d worker%s\n",
+            samples, samples / 2083334.0, workers, workers == 1 ? "" : "s");
 
-    *center = (dphi_one_total + dphi_zero_total) / 2;
+    fprintf(stderr, "%-14s %15s %15s %8s %8s\n",
+            "discriminator", "front end", "demodulator", "ADS-B", "uplink");
 
-    // recheck sync word using our center value
-    error_bits = 0;
-    for (i = 0; i < SYNC_BITS; ++i) {
-        int16_t dphi = phi_difference(phi[i*2], phi[i*2+1]);
+    for (i = 0; methods[i].name; ++i) {
+        double start, frontend_time, demod_time;
+        size_t pos;
 
-        if (pattern & (1UL << (35-i))) {
-            if (dphi < *center)
-                ++error_bits;
-        } else {
-            if (dphi >= *center)
-                ++error_bits;
+        discriminator = methods[i].discriminator;
+
+        // front end only
+        start = monotonic_seconds();
+        for (pos = 0; pos + 1 < samples; pos += 65535) {
+            size_t chunk = samples - pos - 1;
+            if (chunk > 65535)
+                chunk = 65535;
+            convert_to_dphi(discriminator, dphi, (uint16_t *) bench_data + pos, chunk);
         }
+        frontend_time = monotonic_seconds() - start;
+
+        // complete demodulator
+        adsb_frames = uplink_frames = 0;
+        squelch_init(&squelch, squelch.enabled, squelch.margin);
+        bench_pos = 0;
+        start = monotonic_seconds();
+        demodulate(read_from_bench);
+        demod_time = monotonic_seconds() - start;
+
+        fprintf(stderr, "%-14s %10.1f Msps %10.1f Msps %8u %8u\n",
+                methods[i].name,
+                samples / frontend_time / 1e6,
+                samples / demod_time / 1e6,
+                adsb_frames, uplink_frames);
     }
 
-    //fprintf(stdout, "check_sync_word: center=%.0fkHz, errors=%d\n", *center * 2083334.0 / 65536 / 1000, error_bits);
-
-    return (error_bits <= MAX_SYNC_ERRORS);
+    free(dphi);
+    free(bench_data);
+    return 0;
 }
 
-#define SYNC_MASK ((((uint64_t)1)<<SYNC_BITS)-1)
-
-int process_buffer(uint16_t *phi, uint16_t *raw, int len, uint64_t offset)    
+// Search for and demodulate frames in 'len' samples, with 'dphi' holding
+// the len-1 phase differences between those samples and 'energy' the
+// running energy totals (at least len-1 of them).
+// 'offset' is the sample offset of the first sample in the input stream.
+// Returns the number of samples consumed.
+static int process_buffer(int16_t *dphi, uint32_t *energy, int len, uint64_t offset)
 {
-    uint64_t sync0 = 0, sync1 = 0;
-    int lenbits;
-    int bit;
-
-    uint8_t demod_buf_a[UPLINK_FRAME_BYTES];
-    uint8_t demod_buf_b[UPLINK_FRAME_BYTES];
+    static struct sync_scan scan;
+    struct sync_candidate cand;
+    struct demod_result frame;
+    int nstarts;
 
     // We expect samples at twice the UAT bitrate.
     // We look at phase difference between pairs of adjacent samples, i.e.
-    //  sample 1 - sample 0   -> sync0
-    //  sample 2 - sample 1   -> sync1
-    //  sample 3 - sample 2   -> sync0
-    //  sample 4 - sample 3   -> sync1
+    //  sample 1 - sample 0   -> bitstream 0
+    //  sample 2 - sample 1   -> bitstream 1
+    //  sample 3 - sample 2   -> bitstream 0
+    //  sample 4 - sample 3   -> bitstream 1
     // ...
     //
-    // We accumulate bits into two buffers, sync0 and sync1.
-    // Then we compare those buffers to the expected 36-bit sync word that
-    // should be at the start of each UAT frame. When (if) we find it,
-    // that tells us which sample to start decoding from.
+    // We look for the expected 36-bit sync word that should be at the
+    // start of each UAT frame in both bitstreams (see demod.c).
+    // When (if) we find it, that tells us which sample to start decoding
+    // from.
 
     // Stop when we run out of remaining samples for a max-sized frame.
     // Arrange for our caller to pass the trailing data back to us next time;
     // ensure we don't consume any partial sync word we might be part-way
-    // through. This means we don't need to maintain state between calls.
-
-    lenbits = len/2 - (SYNC_BITS + UPLINK_FRAME_BITS);
-    for (bit = 0; bit < lenbits; ++bit) {
-        int16_t dphi0 = phi_difference(phi[bit*2], phi[bit*2+1]);
-        int16_t dphi1 = phi_difference(phi[bit*2+1], phi[bit*2+2]);
-
-        sync0 = ((sync0 << 1) | (dphi0 > 0 ? 1 : 0)) & SYNC_MASK;
-        sync1 = ((sync1 << 1) | (dphi1 > 0 ? 1 : 0)) & SYNC_MASK;
-
-        if (bit < SYNC_BITS)
-            continue; // haven't fully populated sync0/1 yet
-
-        // see if we have (the start of) a valid sync word
-        // It would be nice to look at popcount(expected ^ sync) 
-        // so we can tolerate some errors, but that turns out
-        // to be very expensive to do on every sample
-
-        // when we find a match, try to demodulate both with that match
-        // and with the next position, and pick the one with fewer
-        // errors.
-
-        // check for downlink frames:
-        if (sync_word_fuzzy_compare(sync0, ADSB_SYNC_WORD) || sync_word_fuzzy_compare(sync1, ADSB_SYNC_WORD)) {
-            int startbit = (bit-SYNC_BITS+1);
-            int shift = (sync_word_fuzzy_compare(sync0, ADSB_SYNC_WORD) ? 0 : 1);
-            int index = startbit*2+shift;
-
-            int skip_0, skip_1;
-            int rs_0 = -1, rs_1 = -1;
-            float signal_strength = 0;
-
-            skip_0 = demod_adsb_frame(phi+index, demod_buf_a, &rs_0);
-            skip_1 = demod_adsb_frame(phi+index+1, demod_buf_b, &rs_1);
-            if (skip_0 && rs_0 <= rs_1) {
-                signal_strength = calc_power(raw + index, skip_0 * 2);
-                handle_adsb_frame(offset+index, demod_buf_a, rs_0, signal_strength);
-                bit = startbit + skip_0;
-                continue;
-            } else if (skip_1 && rs_1 <= rs_0) {
-                signal_strength = calc_power(raw + index + 1, skip_1 * 2);
-                handle_adsb_frame(offset+index+1, demod_buf_b, rs_1, signal_strength);
-                bit = startbit + skip_1;
-                continue;
-            } else {
-                // demod failed
-            }
-        }
+    // through. The only state kept between calls is where the search
+    // resumes after a frame that ran past the end of the previous search;
+    // the squelch still sees every sample, so its noise floor does not
+    // depend on how the input was split up.
 
-        // check for uplink frames:
-        else if (sync_word_fuzzy_compare(sync0, UPLINK_SYNC_WORD) || sync_word_fuzzy_compare(sync1, UPLINK_SYNC_WORD)) {
-            int startbit = (bit-SYNC_BITS+1);
-            int shift = (sync_word_fuzzy_compare(sync0, UPLINK_SYNC_WORD) ? 0 : 1);
-            int index = startbit*2+shift;
-
-            int skip_0, skip_1;
-            int rs_0 = -1, rs_1 = -1;
-            float signal_strength = 0;
-
-            skip_0 = demod_uplink_frame(phi+index, demod_buf_a, &rs_0);
-            skip_1 = demod_uplink_frame(phi+index+1, demod_buf_b, &rs_1);
-            if (skip_0 && rs_0 <= rs_1) {
-                signal_strength = calc_power(raw + index, skip_0 * 2);
-                handle_uplink_frame(offset+index, demod_buf_a, rs_0, signal_strength);
-                bit = startbit + skip_0;
-                continue;
-            } else if (skip_1 && rs_1 <= rs_0) {
-                signal_strength = calc_power(raw + index, skip_1 * 2);
-                handle_uplink_frame(offset+index+1, demod_buf_b, rs_1, signal_strength);
-                bit = startbit + skip_1;
-                continue;
-            } else {
-                // demod failed
-            }
-        }
-    }
-
-    return (bit - SYNC_BITS)*2;
-}
-
-// demodulate 'bytes' bytes from samples at 'phi' into 'frame',
-// using 'center_dphi' as the bit slicing threshold
-static void demod_frame(uint16_t *phi, uint8_t *frame, int bytes, int16_t center_dphi)
-{
-    while (--bytes >= 0) {
-        uint8_t b = 0;
-        if (phi_difference(phi[0], phi[1]) > center_dphi) b |= 0x80;
-        if (phi_difference(phi[2], phi[3]) > center_dphi) b |= 0x40;
-        if (phi_difference(phi[4], phi[5]) > center_dphi) b |= 0x20;
-        if (phi_difference(phi[6], phi[7]) > center_dphi) b |= 0x10;
-        if (phi_difference(phi[8], phi[9]) > center_dphi) b |= 0x08;
-        if (phi_difference(phi[10], phi[11]) > center_dphi) b |= 0x04;
-        if (phi_difference(phi[12], phi[13]) > center_dphi) b |= 0x02;
-        if (phi_difference(phi[14], phi[15]) > center_dphi) b |= 0x01;
-        *frame++ = b;
-        phi += 16;
-    }
-}
-
-// Demodulate an ADSB (Long UAT or Basic UAT) downlink frame
-// with the first sync bit in 'phi', storing the frame into 'to'
-// of length up to LONG_FRAME_BYTES. Set '*rs_errors' to the
-// number of corrected errors, or 9999 if demodulation failed.
-// Return 0 if demodulation failed, or the number of bits (not
-// samples) consumed if demodulation was OK.
-static int demod_adsb_frame(uint16_t *phi, uint8_t *to, int *rs_errors)
-{
-    int16_t center_dphi;
-    int frametype;
-
-    if (!check_sync_word(phi, ADSB_SYNC_WORD, &center_dphi)) {
-        *rs_errors = 9999;
+    nstarts = (len - DEMOD_LOOKAHEAD) / 2;
+    if (nstarts <= 0)
         return 0;
-    }
 
-    demod_frame(phi + SYNC_BITS*2, to, LONG_FRAME_BYTES, center_dphi);    
-    frametype = correct_adsb_frame(to, rs_errors);
-    if (frametype == 1)
-        return (SYNC_BITS + SHORT_FRAME_BITS);
-    else if (frametype == 2)
-        return (SYNC_BITS + LONG_FRAME_BITS);
-    else
-        return 0;
-}
+    sync_scan_init(&scan, dphi, energy, offset, nstarts, &squelch);
+    if (search_resume > offset)
+        sync_scan_resume(&scan, (search_resume - offset) / 2);
 
-// Demodulate an uplink frame
-// with the first sync bit in 'phi', storing the frame into 'to'
-// of length up to UPLINK_FRAME_BYTES. Set '*rs_errors' to the
-// number of corrected errors, or 9999 if demodulation failed.
-// Return 0 if demodulation failed, or the number of bits (not
-// samples) consumed if demodulation was OK.
-static int demod_uplink_frame(uint16_t *phi, uint8_t *to, int *rs_errors)
-{
-    int16_t center_dphi;
-    uint8_t interleaved[UPLINK_FRAME_BYTES];
+    while (sync_scan_next(&scan, &cand)) {
+        if (demod_candidate(dphi + cand.index, energy + cand.index, cand.type, fec_retries, &frame)) {
+            frame.noise_floor = cand.noise_floor;
+            handle_frame(offset + cand.index + frame.shift, &frame);
 
-    if (!check_sync_word(phi, UPLINK_SYNC_WORD, &center_dphi)) {
-        *rs_errors = 9999;
-        return 0;
+            // after a successful demodulation, resume searching
+            // immediately after the end of the frame
+            sync_scan_resume(&scan, cand.startbit + frame.bits);
+        }
     }
 
-    demod_frame(phi + SYNC_BITS*2, interleaved, UPLINK_FRAME_BYTES, center_dphi);
-
-    // deinterleave and correct
-    if (correct_uplink_frame(interleaved, to, rs_errors) == 1)
-        return (UPLINK_FRAME_BITS+SYNC_BITS);
-    else
-        return 0;
+    search_resume = offset + sync_scan_end(&scan) * 2;
+    return nstarts * 2;
 }
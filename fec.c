@@ -23,28 +23,116 @@
 #include <unistd.h>
 
 #include "uat.h"
+#include "fec.h"
 #include "fec/rs.h"
 
-static void *rs_uplink;
-static void *rs_adsb_short;
-static void *rs_adsb_long;
+// The decoders themselves (fec/decode_rs_uat.c) have these code
+// parameters built in; all three codes use field generator polynomial
+// 0x187, fcr 120 and prim 1.
+#define ADSB_SHORT_NROOTS 12
+#define ADSB_SHORT_PAD    (255 - SHORT_FRAME_BYTES)
+#define ADSB_LONG_NROOTS  14
+#define ADSB_LONG_PAD     (255 - LONG_FRAME_BYTES)
+#define UPLINK_NROOTS     20
+#define UPLINK_PAD        (255 - UPLINK_BLOCK_BYTES)
 
-#define UPLINK_POLY 0x187
-#define ADSB_POLY 0x187
+typedef int (*rs_decoder_t)(uint8_t *data, int *eras_pos, int no_eras);
 
-void init_fec(void)
+//
+// Erasure retries.
+//
+// A Reed-Solomon code with NROOTS parity symbols corrects any combination
+// of E erasures (symbols known to be suspect) and V errors with
+// 2V + E <= NROOTS. When a frame fails ordinary decoding, we can guess
+// which bytes are bad from how close their bits were to the slicing
+// threshold, and retry with the least confident bytes marked as erasures.
+//
+// Each retry marks more bytes, up to half of the parity symbols; beyond
+// that there is too little redundancy left to reject a wrong guess.
+// Decodes that claim more corrections than the erasures and remaining
+// parity allow are rejected as miscorrections. (The decoders already
+// reject "corrections" to the known-zero padding of the shortened code.)
+//
+
+#define MAX_ERASURES(nroots) ((nroots) / 2)
+
+// Store the indices of the 'k' least confident of 'len' bytes in 'order',
+// least confident first. The confidence of byte i is confidence[i * stride].
+static void least_confident(const uint16_t *confidence, int len, int stride, int *order, int k)
+{
+    int i, j, n = 0;
+
+    for (i = 0; i < len; ++i) {
+        uint16_t c = confidence[i * stride];
+
+        if (n == k && c >= confidence[order[k - 1] * stride])
+            continue;
+
+        // insertion sort into the (short) list of candidates
+        j = (n < k ? n++ : k - 1);
+        for (; j > 0 && confidence[order[j - 1] * stride] > c; --j)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+}
+
+// Number of retries to make when asked for 'retries' with at most 'max'
+// erasures: more than one retry per erasure count would just repeat a
+// decode that already failed
+static int retry_attempts(int retries, int max)
 {
-    rs_adsb_short = init_rs_char(8, /* gfpoly */ ADSB_POLY, /* fcr */ 120, /* prim */ 1, /* nroots */ 12, /* pad */ 225);
-    rs_adsb_long  = init_rs_char(8, /* gfpoly */ ADSB_POLY, /* fcr */ 120, /* prim */ 1, /* nroots */ 14, /* pad */ 207);
-    rs_uplink     = init_rs_char(8, /* gfpoly */ UPLINK_POLY, /* fcr */ 120, /* prim */ 1, /* nroots */ 20, /* pad */ 163);
+    return (retries < max ? retries : max);
+}
+
+// Number of erasures to mark on retry 'attempt' (1..'attempts', as
+// returned by retry_attempts()), spreading the retries evenly up to 'max';
+// each attempt gets a different count
+static int retry_erasures(int attempt, int attempts, int max)
+{
+    return (attempt * max + attempts - 1) / attempts;
+}
+
+// Copy 'len' bytes of 'data' to 'out' and decode them with the first
+// 'erasures' bytes listed in 'order' marked as erasures. Returns the
+// number of symbols that were changed (erased bytes that turn out to be
+// right don't count), or -1 if decoding failed or the result looks like
+// a miscorrection.
+static int decode_erasures(rs_decoder_t decode, int nroots, int pad, const uint8_t *data, uint8_t *out, int len,
+                           const int *order, int erasures)
+{
+    int eras_pos[UPLINK_NROOTS];
+    int i, n, changed;
+
+    memcpy(out, data, len);
+    for (i = 0; i < erasures; ++i)
+        eras_pos[i] = order[i] + pad;
+
+    // the decoder's count includes every erasure, changed or not
+    n = decode(out, eras_pos, erasures);
+    if (n < 0 || n > erasures + (nroots - erasures) / 2)
+        return -1;
+
+    for (i = 0, changed = 0; i < len; ++i)
+        changed += (out[i] != data[i]);
+    return changed;
 }
 
 int correct_adsb_frame(uint8_t *to, int *rs_errors)
 {
+    const uint8_t *data = to;
+    int n_corrected;
+
+    // A clean Basic UAT frame fails the long code, so check it against the
+    // short code before running the long decoder over it.
+    if ((to[0]>>3) == 0 && !uat_syndrome_mask(&data, 1, SHORT_FRAME_BYTES, ADSB_SHORT_NROOTS)) {
+        *rs_errors = 0;
+        return 1;
+    }
+
     // Try decoding as a Long UAT.
-    // We rely on decode_rs_char not modifying the data if there were
+    // We rely on the decoder not modifying the data if there were
     // uncorrectable errors.
-    int n_corrected = decode_rs_char(rs_adsb_long, to, NULL, 0);
+    n_corrected = decode_rs_adsb_long(to, NULL, 0);
     if (n_corrected >= 0 && n_corrected <= 7 && (to[0]>>3) != 0) {
         // Valid long frame.
         *rs_errors = n_corrected;
@@ -52,7 +140,7 @@ int correct_adsb_frame(uint8_t *to, int *rs_errors)
     }
 
     // Retry as Basic UAT
-    n_corrected = decode_rs_char(rs_adsb_short, to, NULL, 0);
+    n_corrected = decode_rs_adsb_short(to, NULL, 0);
     if (n_corrected >= 0 && n_corrected <= 6 && (to[0]>>3) == 0) {
         // Valid short frame
         *rs_errors = n_corrected;
@@ -64,30 +152,265 @@ int correct_adsb_frame(uint8_t *to, int *rs_errors)
     return -1;
 }
 
+// The erasure retries of correct_adsb_frame_soft, for a frame that has
+// already failed plain decoding
+static int adsb_erasure_retries(uint8_t *to, const uint16_t *confidence, int retries, int *rs_errors)
+{
+    int long_order[MAX_ERASURES(ADSB_LONG_NROOTS)];
+    int short_order[MAX_ERASURES(ADSB_SHORT_NROOTS)];
+    uint8_t out[LONG_FRAME_BYTES];
+    int long_attempts = retry_attempts(retries, MAX_ERASURES(ADSB_LONG_NROOTS));
+    int short_attempts = retry_attempts(retries, MAX_ERASURES(ADSB_SHORT_NROOTS));
+    int attempt, n;
+
+    least_confident(confidence, LONG_FRAME_BYTES, 1, long_order, MAX_ERASURES(ADSB_LONG_NROOTS));
+    least_confident(confidence, SHORT_FRAME_BYTES, 1, short_order, MAX_ERASURES(ADSB_SHORT_NROOTS));
+
+    // As with plain decoding, try the long code first. The first part of a
+    // long frame with a damaged type field can look like a short frame with
+    // a few errors, so all of the long retries come before any short ones.
+    for (attempt = 1; attempt <= long_attempts; ++attempt) {
+        n = decode_erasures(decode_rs_adsb_long, ADSB_LONG_NROOTS, ADSB_LONG_PAD, to, out, LONG_FRAME_BYTES,
+                            long_order, retry_erasures(attempt, long_attempts, MAX_ERASURES(ADSB_LONG_NROOTS)));
+        if (n >= 0 && (out[0]>>3) != 0) {
+            memcpy(to, out, LONG_FRAME_BYTES);
+            *rs_errors = n;
+            return 2;
+        }
+    }
+
+    for (attempt = 1; attempt <= short_attempts; ++attempt) {
+        n = decode_erasures(decode_rs_adsb_short, ADSB_SHORT_NROOTS, ADSB_SHORT_PAD, to, out, SHORT_FRAME_BYTES,
+                            short_order, retry_erasures(attempt, short_attempts, MAX_ERASURES(ADSB_SHORT_NROOTS)));
+        if (n >= 0 && (out[0]>>3) == 0) {
+            memcpy(to, out, SHORT_FRAME_BYTES);
+            *rs_errors = n;
+            return 1;
+        }
+    }
+
+    *rs_errors = 9999;
+    return -1;
+}
+
+int correct_adsb_frame_soft(uint8_t *to, const uint16_t *confidence, int retries, int *rs_errors)
+{
+    int frametype = correct_adsb_frame(to, rs_errors);
+    if (frametype > 0 || retries <= 0)
+        return frametype;
+
+    return adsb_erasure_retries(to, confidence, retries, rs_errors);
+}
+
 int correct_uplink_frame(uint8_t *from, uint8_t *to, int *rs_errors)
 {
-    int block;
-    int total_corrected = 0;
+    return correct_uplink_frame_soft(from, NULL, to, 0, rs_errors);
+}
 
-    for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block) {
-        int i, n_corrected;
-        uint8_t *blockdata = &to[block * UPLINK_BLOCK_DATA_BYTES];
+int correct_uplink_frame_soft(uint8_t *from, const uint16_t *confidence, uint8_t *to, int retries, int *rs_errors)
+{
+    uint8_t blocks[UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+    int block, i;
 
+    for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block)
         for (i = 0; i < UPLINK_BLOCK_BYTES; ++i)
-            blockdata[i] = from[i * UPLINK_FRAME_BLOCKS + block];
+            blocks[block][i] = from[i * UPLINK_FRAME_BLOCKS + block];
+
+    return correct_uplink_blocks(blocks, confidence, to, retries, rs_errors);
+}
+
+// Retry the deinterleaved uplink block 'block' with erasures; 'confidence'
+// covers the whole interleaved frame
+static int retry_uplink_block(const uint16_t *confidence, int block, uint8_t *blockdata, int retries)
+{
+    int order[MAX_ERASURES(UPLINK_NROOTS)];
+    uint8_t out[UPLINK_BLOCK_BYTES];
+    int attempts = retry_attempts(retries, MAX_ERASURES(UPLINK_NROOTS));
+    int attempt, n;
+
+    least_confident(confidence + block, UPLINK_BLOCK_BYTES, UPLINK_FRAME_BLOCKS, order,
+                    MAX_ERASURES(UPLINK_NROOTS));
+
+    for (attempt = 1; attempt <= attempts; ++attempt) {
+        n = decode_erasures(decode_rs_uplink, UPLINK_NROOTS, UPLINK_PAD, blockdata, out, UPLINK_BLOCK_BYTES,
+                            order, retry_erasures(attempt, attempts, MAX_ERASURES(UPLINK_NROOTS)));
+        if (n >= 0) {
+            memcpy(blockdata, out, UPLINK_BLOCK_BYTES);
+            return n;
+        }
+    }
+
+    return -1;
+}
+
+// Correct the blocks of an uplink frame from 'block' on, given a bitmask
+// of those with nonzero syndromes ('dirty'); the others only need
+// copying out. 'total' counts the errors already corrected in earlier
+// blocks. If 'retry_first' is set, 'block' has already failed plain
+// decoding and goes straight to the erasure retries.
+// If decoding fails and 'frame' is not NULL, record in it where decoding
+// stopped, for retry_uplink_frame().
+static int correct_dirty_blocks(uint8_t blocks[][UPLINK_BLOCK_BYTES], int block, unsigned dirty, int total,
+                                int retry_first, const uint16_t *confidence, uint8_t *to, int retries,
+                                int *rs_errors, struct fec_frame *frame)
+{
+    for (; block < UPLINK_FRAME_BLOCKS; ++block) {
+        int n_corrected = 0;
+        uint8_t *blockdata = blocks[block];
 
         // error-correct in place
-        n_corrected = decode_rs_char(rs_uplink, blockdata, NULL, 0);
-        if (n_corrected < 0 || n_corrected > 10) {
+        if (retry_first)
+            n_corrected = -1;
+        else if (dirty & (1 << block))
+            n_corrected = decode_rs_uplink(blockdata, NULL, 0);
+        retry_first = 0;
+        if (n_corrected > 10)
+            n_corrected = -1;
+        if (n_corrected < 0 && confidence && retries > 0)
+            n_corrected = retry_uplink_block(confidence, block, blockdata, retries);
+
+        if (n_corrected < 0) {
             // Failed
+            if (frame) {
+                frame->failed_block = block;
+                frame->dirty = dirty;
+                frame->partial_errors = total;
+            }
             *rs_errors = 9999;
             return -1;
         }
 
-        total_corrected += n_corrected;
-        // next block (if there is one) will overwrite the ECC bytes.
+        total += n_corrected;
+        memcpy(&to[block * UPLINK_BLOCK_DATA_BYTES], blockdata, UPLINK_BLOCK_DATA_BYTES);
     }
 
-    *rs_errors = total_corrected;
+    *rs_errors = total;
     return 1;
 }
+
+int correct_uplink_blocks(uint8_t blocks[][UPLINK_BLOCK_BYTES], const uint16_t *confidence, uint8_t *to,
+                          int retries, int *rs_errors)
+{
+    const uint8_t *data[UPLINK_FRAME_BLOCKS];
+    int block;
+
+    // Check the syndromes of all blocks together; usually they are all
+    // clean.
+    for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block)
+        data[block] = blocks[block];
+
+    return correct_dirty_blocks(blocks, 0, uat_syndrome_mask(data, UPLINK_FRAME_BLOCKS, UPLINK_BLOCK_BYTES, UPLINK_NROOTS),
+                                0, 0, confidence, to, retries, rs_errors, NULL);
+}
+
+//
+// Batches.
+//
+// The syndrome check covers up to BATCH_BLOCKS blocks per call, so
+// batches are taken that many frames (or uplink blocks) at a time.
+//
+
+#define BATCH_BLOCKS 32
+#define UPLINK_BATCH_FRAMES (BATCH_BLOCKS / UPLINK_FRAME_BLOCKS)
+
+int correct_adsb_frames(struct fec_frame *frames, int n, int retries)
+{
+    int base, i, valid = 0;
+
+    for (base = 0; base < n; base += BATCH_BLOCKS) {
+        const uint8_t *data[BATCH_BLOCKS];
+        const uint8_t *short_data[BATCH_BLOCKS];
+        int short_index[BATCH_BLOCKS];
+        int count = (n - base < BATCH_BLOCKS ? n - base : BATCH_BLOCKS);
+        int short_count = 0;
+        unsigned dirty, short_clean = 0;
+
+        for (i = 0; i < count; ++i)
+            data[i] = frames[base + i].data;
+        dirty = uat_syndrome_mask(data, count, LONG_FRAME_BYTES, ADSB_LONG_NROOTS);
+
+        // frames that claim to be Basic UAT get a second batch against the
+        // short code
+        for (i = 0; i < count; ++i) {
+            if ((data[i][0]>>3) == 0) {
+                short_index[short_count] = i;
+                short_data[short_count++] = data[i];
+            }
+        }
+        if (short_count > 0) {
+            unsigned short_dirty = uat_syndrome_mask(short_data, short_count, SHORT_FRAME_BYTES, ADSB_SHORT_NROOTS);
+            for (i = 0; i < short_count; ++i)
+                if (!(short_dirty & (1U << i)))
+                    short_clean |= 1U << short_index[i];
+        }
+
+        for (i = 0; i < count; ++i) {
+            struct fec_frame *frame = &frames[base + i];
+
+            if (!(dirty & (1U << i)) && (frame->data[0]>>3) != 0) {
+                // a clean long frame; nothing for the decoders to do
+                frame->frametype = 2;
+                frame->rs_errors = 0;
+            } else if (short_clean & (1U << i)) {
+                // likewise for a clean short frame
+                frame->frametype = 1;
+                frame->rs_errors = 0;
+            } else {
+                frame->frametype = correct_adsb_frame_soft(frame->data, frame->confidence,
+                                                           frame->confidence ? retries : 0, &frame->rs_errors);
+            }
+
+            if (frame->frametype > 0)
+                ++valid;
+        }
+    }
+
+    return valid;
+}
+
+int correct_uplink_frames(struct fec_frame *frames, int n, int retries)
+{
+    int base, i, block, valid = 0;
+
+    for (base = 0; base < n; base += UPLINK_BATCH_FRAMES) {
+        const uint8_t *data[UPLINK_BATCH_FRAMES * UPLINK_FRAME_BLOCKS];
+        int count = (n - base < UPLINK_BATCH_FRAMES ? n - base : UPLINK_BATCH_FRAMES);
+        unsigned dirty;
+
+        for (i = 0; i < count; ++i)
+            for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block)
+                data[i * UPLINK_FRAME_BLOCKS + block] = frames[base + i].data + block * UPLINK_BLOCK_BYTES;
+        dirty = uat_syndrome_mask(data, count * UPLINK_FRAME_BLOCKS, UPLINK_BLOCK_BYTES, UPLINK_NROOTS);
+
+        for (i = 0; i < count; ++i) {
+            struct fec_frame *frame = &frames[base + i];
+
+            frame->frametype = correct_dirty_blocks((uint8_t (*)[UPLINK_BLOCK_BYTES]) frame->data, 0,
+                                                    (dirty >> (i * UPLINK_FRAME_BLOCKS)) & ((1U << UPLINK_FRAME_BLOCKS) - 1),
+                                                    0, 0, frame->confidence, frame->to,
+                                                    frame->confidence ? retries : 0, &frame->rs_errors, frame);
+            if (frame->frametype > 0)
+                ++valid;
+        }
+    }
+
+    return valid;
+}
+
+int retry_adsb_frame(struct fec_frame *frame, const uint16_t *confidence, int retries)
+{
+    if (frame->frametype < 0 && retries > 0)
+        frame->frametype = adsb_erasure_retries(frame->data, confidence, retries, &frame->rs_errors);
+    return frame->frametype;
+}
+
+int retry_uplink_frame(struct fec_frame *frame, const uint16_t *confidence, int retries)
+{
+    // Blocks before the one that failed are already corrected and copied
+    // out; the failed block and those after it are as demodulated.
+    if (frame->frametype < 0 && retries > 0)
+        frame->frametype = correct_dirty_blocks((uint8_t (*)[UPLINK_BLOCK_BYTES]) frame->data, frame->failed_block,
+                                                frame->dirty, frame->partial_errors, 1, confidence, frame->to,
+                                                retries, &frame->rs_errors, frame);
+    return frame->frametype;
+}
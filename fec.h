@@ -18,9 +18,6 @@
 #ifndef DUMP978_FEC_H
 #define DUMP978_FEC_H
 
-/* Initialize. Must be called once before correct_* */
-void init_fec(void);
-
 /* Correct a downlink frame.
  *
  * 'to' should contain LONG_FRAME_BYTES of data.
@@ -30,6 +27,15 @@ void init_fec(void);
  */
 int correct_adsb_frame(uint8_t *to, int *rs_errors);
 
+/* As correct_adsb_frame, but if that fails, retry up to 'retries' times
+ * (at most once per erasure count) with increasing numbers of the least
+ * confident bytes marked as erasures.
+ *
+ * 'confidence' holds one value per byte of 'to' (LONG_FRAME_BYTES); lower
+ * values mark bytes that are more likely to be wrong.
+ */
+int correct_adsb_frame_soft(uint8_t *to, const uint16_t *confidence, int retries, int *rs_errors);
+
 /* Deinterleave and correct an uplink frame.
  *
  * 'from' should point to UPLINK_FRAME_BYTES of interleaved input data
@@ -41,4 +47,57 @@ int correct_adsb_frame(uint8_t *to, int *rs_errors);
  */
 int correct_uplink_frame(uint8_t *from, uint8_t *to, int *rs_errors);
 
+/* As correct_uplink_frame, but retry each block that fails up to 'retries'
+ * times (at most once per erasure count) with increasing numbers of its
+ * least confident bytes marked as erasures.
+ *
+ * 'confidence' holds one value per byte of 'from' (UPLINK_FRAME_BYTES, still
+ * interleaved); lower values mark bytes that are more likely to be wrong.
+ * It may be NULL if 'retries' is 0.
+ */
+int correct_uplink_frame_soft(uint8_t *from, const uint16_t *confidence, uint8_t *to, int retries, int *rs_errors);
+
+/* As correct_uplink_frame_soft, but for a frame that is already
+ * deinterleaved into 'blocks'. The blocks are corrected in place (and may
+ * be partly corrected on failure), then their data is written to 'to'.
+ * 'confidence' is still in the order of the interleaved frame.
+ */
+int correct_uplink_blocks(uint8_t blocks[][UPLINK_BLOCK_BYTES], const uint16_t *confidence, uint8_t *to,
+                          int retries, int *rs_errors);
+
+/* One frame of a batch for correct_adsb_frames / correct_uplink_frames. */
+struct fec_frame {
+    uint8_t *data;              /* ADS-B: LONG_FRAME_BYTES, corrected in place;
+                                   uplink: deinterleaved blocks, as for correct_uplink_blocks */
+    uint8_t *to;                /* uplink: output, as for correct_uplink_blocks */
+    const uint16_t *confidence; /* for erasure retries, or NULL */
+    int frametype;              /* out: as returned by the single-frame functions */
+    int rs_errors;              /* out */
+
+    /* uplink: where correction stopped on failure, for retry_uplink_frame */
+    int failed_block;
+    unsigned dirty;
+    int partial_errors;
+};
+
+/* Batch versions of correct_adsb_frame_soft and correct_uplink_blocks.
+ *
+ * Correct each of the 'n' frames in 'frames' as the single-frame function
+ * would, retrying frames that have a confidence array up to 'retries'
+ * times. The syndromes of the whole batch are checked together first, so
+ * clean frames never reach the decoders.
+ * Returns the number of frames that were corrected.
+ */
+int correct_adsb_frames(struct fec_frame *frames, int n, int retries);
+int correct_uplink_frames(struct fec_frame *frames, int n, int retries);
+
+/* Retry a frame from a batch that failed correction (frametype < 0) up
+ * to 'retries' times with erasures, as the _soft functions would, but
+ * without repeating the plain decoding that the batch already tried.
+ * 'confidence' is as for the single-frame functions. Updates and returns
+ * frame->frametype, and updates frame->rs_errors.
+ */
+int retry_adsb_frame(struct fec_frame *frame, const uint16_t *confidence, int retries);
+int retry_uplink_frame(struct fec_frame *frame, const uint16_t *confidence, int retries);
+
 #endif
@@ -20,6 +20,14 @@
  * PRIM - The primitive root of the generator poly. Integer variable or literal.
  * DEBUG - If set to 1 or more, do various internal consistency checking. Leave this
  *         undefined for production code
+ * SHORTENED - If defined, only search for errors in the NN-PAD positions that
+ *         are actually present in a shortened block, rather than in all NN.
+ *         A root of the error locator among the (always zero) pad symbols then
+ *         makes the block uncorrectable instead of being silently ignored.
+ *         Requires PRIM == 1.
+ * SYNDROMES(data, s) - If defined, used instead of the generic loop to compute the
+ *         NROOTS syndromes of data[] into s[], in polynomial form. Must evaluate to
+ *         zero if all of the syndromes are zero, nonzero otherwise.
 
  * The memset(), memmove(), and memcpy() functions are used. The appropriate header
  * file declaring these functions (usually <string.h>) must be included by the calling
@@ -79,6 +87,13 @@
   int syn_error, count;
 
   /* form the syndromes; i.e., evaluate data(x) at roots of g(x) */
+#ifdef SYNDROMES
+  if (!SYNDROMES(data, s)) {
+    /* data[] is a codeword: return it unmodified without going any further */
+    count = 0;
+    goto finish;
+  }
+#else
   for(i=0;i<NROOTS;i++)
     s[i] = data[0];
 
@@ -91,6 +106,7 @@
       }
     }
   }
+#endif
 
   /* Convert syndromes to index form, checking for nonzero condition */
   syn_error = 0;
@@ -213,9 +229,18 @@
       deg_lambda = i;
   }
   /* Find roots of the error+erasure locator polynomial by Chien search */
+#ifdef SHORTENED
+  /* With PRIM == 1, step i of the search tests location i-1, so skip
+   * straight to location PAD: advance reg[j] by j*PAD steps up front */
+  for (j = 1; j <= NROOTS; j++)
+    reg[j] = (lambda[j] == A0) ? A0 : MODNN(lambda[j] + j*PAD);
+  count = 0;		/* Number of roots of lambda(x) */
+  for (i = PAD+1,k=PAD; i <= NN; i++,k++) {
+#else
   memcpy(&reg[1],&lambda[1],NROOTS*sizeof(reg[0]));
   count = 0;		/* Number of roots of lambda(x) */
   for (i = 1,k=IPRIM-1; i <= NN; i++,k = MODNN(k+IPRIM)) {
+#endif
     q = 1; /* lambda[0] is always 0 */
     for (j = deg_lambda; j > 0; j--){
       if (reg[j] != A0) {
@@ -285,7 +310,11 @@
     }
 #endif
     /* Apply error to data */
+#ifdef SHORTENED
+    if (num1 != 0) {
+#else
     if (num1 != 0 && loc[j] >= PAD) {
+#endif
       data[loc[j]-PAD] ^= ALPHA_TO[MODNN(INDEX_OF[num1] + INDEX_OF[num2] + NN - INDEX_OF[den])];
     }
   }
@@ -0,0 +1,426 @@
+/* Reed-Solomon decoders specialized for the three UAT codes
+ * Based on decode_rs_char.c, Copyright 2003 Phil Karn, KA9Q
+ * May be used under the terms of the GNU Lesser General Public License (LGPL)
+ *
+ * All UAT codes use 8-bit symbols, field generator polynomial 0x187,
+ * fcr 120 and prim 1, and differ only in the number of roots and the
+ * amount of padding. Building decode_rs.h once per code with those as
+ * literals, and with the GF tables from gen_rs_tables as static const
+ * data, lets the compiler fold all the code parameters and reduce MODNN
+ * to a multiply, with no control block to chase pointers through and
+ * no runtime initialization. The syndromes, which are all that a clean
+ * block needs, are computed with SIMD table lookups where available.
+ */
+
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SYNDROMES_SSSE3
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SYNDROMES_NEON
+#endif
+
+#include "rs.h"
+
+typedef unsigned char data_t;
+
+/* Product tables for multiplying by a constant c, a nibble at a time:
+ * x * c = lo[x & 15] ^ hi[x >> 4] */
+struct gf_mul_table {
+  uint8_t lo[16];
+  uint8_t hi[16];
+};
+
+#include "rs_tables.h"
+
+/* Syndromes.
+ *
+ * The syndromes are the block evaluated at each root of the generator,
+ * s[i] = sum over j of data[j] * r**(len-1-j), where r = alpha**(FCR+i).
+ * Rather than a log/antilog lookup per symbol per root, split the block
+ * into 16-symbol chunks (zero-filled at the front, which does not change
+ * the result) and run Horner's rule on all 16 lanes of a chunk at once:
+ * every lane is multiplied by the same constant r**16, which a pair of
+ * 16-entry table lookups (PSHUFB / TBL) does for a whole vector. That
+ * leaves lane k holding the sum for positions k mod 16, still to be
+ * weighted by r**(15-k); fold the vector in half four times, multiplying
+ * the first half by r**8, r**4, r**2 and r before adding the second half
+ * to it, to end up with the syndrome in lane 0.
+ *
+ * The tables for r**16, r**8, ... r are uat_syndrome_tables[i][0..4].
+ * Returns nonzero if any syndrome is nonzero.
+ */
+
+/* longest block: an uplink block, 92 symbols */
+#define MAX_CHUNKS 6
+
+/* the NEON kernels below have no fallback, and SSSE3 builds need none */
+#if !defined(SYNDROMES_NEON) && !defined(__SSSE3__)
+static int syndromes_scalar(const data_t *data, int len, int nroots, data_t *s){
+  int i, j, any = 0;
+
+  for (i = 0; i < nroots; i++) {
+    const struct gf_mul_table *t = &uat_syndrome_tables[i][4];
+    data_t x = data[0];
+
+    for (j = 1; j < len; j++)
+      x = t->lo[x & 15] ^ t->hi[x >> 4] ^ data[j];
+    s[i] = x;
+    any |= x;
+  }
+
+  return any;
+}
+#endif
+
+#if defined(SYNDROMES_SSSE3)
+
+__attribute__((target("ssse3")))
+static inline __m128i gf_mul_ssse3(__m128i x, const struct gf_mul_table *t){
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  __m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) t->lo), _mm_and_si128(x, nibble));
+  __m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) t->hi),
+                                _mm_and_si128(_mm_srli_epi16(x, 4), nibble));
+  return _mm_xor_si128(lo, hi);
+}
+
+__attribute__((target("ssse3")))
+static int syndromes_ssse3(const data_t *data, int len, int nroots, data_t *s){
+  __m128i chunk[MAX_CHUNKS];
+  uint8_t first[16];
+  int nchunks = (len + 15) / 16;
+  int lead = nchunks * 16 - len;
+  int i, q, any = 0;
+
+  memset(first, 0, lead);
+  memcpy(first + lead, data, 16 - lead);
+  chunk[0] = _mm_loadu_si128((const __m128i *) first);
+  for (q = 1; q < nchunks; q++)
+    chunk[q] = _mm_loadu_si128((const __m128i *) (data + q * 16 - lead));
+
+  for (i = 0; i < nroots; i++) {
+    const struct gf_mul_table *t = uat_syndrome_tables[i];
+    __m128i x = chunk[0];
+
+    for (q = 1; q < nchunks; q++)
+      x = _mm_xor_si128(gf_mul_ssse3(x, &t[0]), chunk[q]);
+
+    x = _mm_xor_si128(gf_mul_ssse3(x, &t[1]), _mm_srli_si128(x, 8));
+    x = _mm_xor_si128(gf_mul_ssse3(x, &t[2]), _mm_srli_si128(x, 4));
+    x = _mm_xor_si128(gf_mul_ssse3(x, &t[3]), _mm_srli_si128(x, 2));
+    x = _mm_xor_si128(gf_mul_ssse3(x, &t[4]), _mm_srli_si128(x, 1));
+
+    s[i] = (data_t) _mm_cvtsi128_si32(x);
+    any |= s[i];
+  }
+
+  return any;
+}
+
+/* Unless the build already assumes SSSE3, the kernel is chosen once at
+ * startup (see select_syndromes below) */
+#ifdef __SSSE3__
+#define syndromes syndromes_ssse3
+#else
+static int (*syndromes)(const data_t *data, int len, int nroots, data_t *s) = syndromes_scalar;
+#endif
+
+#elif defined(SYNDROMES_NEON)
+
+static inline uint8x16_t gf_mul_neon(uint8x16_t x, const struct gf_mul_table *t){
+  uint8x16_t lo = vqtbl1q_u8(vld1q_u8(t->lo), vandq_u8(x, vdupq_n_u8(0x0F)));
+  uint8x16_t hi = vqtbl1q_u8(vld1q_u8(t->hi), vshrq_n_u8(x, 4));
+  return veorq_u8(lo, hi);
+}
+
+static int syndromes(const data_t *data, int len, int nroots, data_t *s){
+  uint8x16_t chunk[MAX_CHUNKS];
+  const uint8x16_t zero = vdupq_n_u8(0);
+  uint8_t first[16];
+  int nchunks = (len + 15) / 16;
+  int lead = nchunks * 16 - len;
+  int i, q, any = 0;
+
+  memset(first, 0, lead);
+  memcpy(first + lead, data, 16 - lead);
+  chunk[0] = vld1q_u8(first);
+  for (q = 1; q < nchunks; q++)
+    chunk[q] = vld1q_u8(data + q * 16 - lead);
+
+  for (i = 0; i < nroots; i++) {
+    const struct gf_mul_table *t = uat_syndrome_tables[i];
+    uint8x16_t x = chunk[0];
+
+    for (q = 1; q < nchunks; q++)
+      x = veorq_u8(gf_mul_neon(x, &t[0]), chunk[q]);
+
+    x = veorq_u8(gf_mul_neon(x, &t[1]), vextq_u8(x, zero, 8));
+    x = veorq_u8(gf_mul_neon(x, &t[2]), vextq_u8(x, zero, 4));
+    x = veorq_u8(gf_mul_neon(x, &t[3]), vextq_u8(x, zero, 2));
+    x = veorq_u8(gf_mul_neon(x, &t[4]), vextq_u8(x, zero, 1));
+
+    s[i] = vgetq_lane_u8(x, 0);
+    any |= s[i];
+  }
+
+  return any;
+}
+
+#else
+
+#define syndromes syndromes_scalar
+
+#endif
+
+/* Batch syndromes.
+ *
+ * Nearly all blocks arrive clean, so a caller with several blocks of one
+ * code in hand (the six blocks of an uplink frame, or a batch of
+ * candidate frames) can find the ones that need the decoder by checking
+ * all of their syndromes together.
+ *
+ * Horner's rule runs on each block's chunks as above, but the folding is
+ * shared between blocks: the first fold takes the first halves of two
+ * blocks' vectors in one multiply, the second takes the first quarters
+ * of four blocks, and so on, until the fourth fold leaves the syndrome
+ * of block b in lane b of a single vector. That is 15 multiplies for 16
+ * blocks rather than 64.
+ *
+ * Returns a bitmask of the blocks with any nonzero syndrome.
+ */
+
+/* blocks per pass, one per lane; larger batches take several passes */
+#define BATCH_MAX 16
+
+#if !defined(SYNDROMES_NEON) && !defined(__SSSE3__)
+static unsigned batch_syndromes_scalar(const data_t *const *blocks, int n, int len, int nroots){
+  data_t s[20];
+  unsigned mask = 0;
+  int b;
+
+  for (b = 0; b < n; b++)
+    if (syndromes_scalar(blocks[b], len, nroots, s))
+      mask |= 1U << b;
+
+  return mask;
+}
+#endif
+
+#if defined(SYNDROMES_SSSE3)
+
+__attribute__((target("ssse3")))
+static unsigned batch_syndromes_ssse3(const data_t *const *blocks, int n, int len, int nroots){
+  const __m128i even16 = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i odd16 = _mm_setr_epi8(2, 3, 6, 7, 10, 11, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i even8 = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i odd8 = _mm_setr_epi8(1, 3, 5, 7, 9, 11, 13, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+  __m128i chunk[BATCH_MAX][MAX_CHUNKS];
+  __m128i any = _mm_setzero_si128();
+  uint8_t first[16];
+  int nchunks = (len + 15) / 16;
+  int lead = nchunks * 16 - len;
+  int i, b, q;
+
+  memset(first, 0, sizeof(first));
+  for (b = 0; b < n; b++) {
+    memcpy(first + lead, blocks[b], 16 - lead);
+    chunk[b][0] = _mm_loadu_si128((const __m128i *) first);
+    for (q = 1; q < nchunks; q++)
+      chunk[b][q] = _mm_loadu_si128((const __m128i *) (blocks[b] + q * 16 - lead));
+  }
+
+  for (i = 0; i < nroots; i++) {
+    const struct gf_mul_table *t = uat_syndrome_tables[i];
+    __m128i x[BATCH_MAX], h;
+    int m = n;
+
+    for (b = 0; b < n; b++) {
+      x[b] = chunk[b][0];
+      for (q = 1; q < nchunks; q++)
+        x[b] = _mm_xor_si128(gf_mul_ssse3(x[b], &t[0]), chunk[b][q]);
+    }
+    /* Each fold halves the number of vectors, m. An odd one out is
+     * paired with zeros, as if with a clean block. */
+
+    /* 8 lanes per block, 2 blocks per vector */
+    if (m & 1)
+      x[m++] = _mm_setzero_si128();
+    for (b = 0, m /= 2; b < m; b++) {
+      h = _mm_unpackhi_epi64(x[2*b], x[2*b+1]);
+      x[b] = _mm_xor_si128(gf_mul_ssse3(_mm_unpacklo_epi64(x[2*b], x[2*b+1]), &t[1]), h);
+    }
+    /* 4 lanes per block */
+    if (m & 1)
+      x[m++] = _mm_setzero_si128();
+    for (b = 0, m /= 2; b < m; b++) {
+      __m128 lo = _mm_castsi128_ps(x[2*b]), hi = _mm_castsi128_ps(x[2*b+1]);
+      h = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+      x[b] = _mm_xor_si128(gf_mul_ssse3(_mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))), &t[2]), h);
+    }
+    /* 2 lanes per block */
+    if (m & 1)
+      x[m++] = _mm_setzero_si128();
+    for (b = 0, m /= 2; b < m; b++) {
+      h = _mm_unpacklo_epi64(_mm_shuffle_epi8(x[2*b], odd16), _mm_shuffle_epi8(x[2*b+1], odd16));
+      x[b] = _mm_unpacklo_epi64(_mm_shuffle_epi8(x[2*b], even16), _mm_shuffle_epi8(x[2*b+1], even16));
+      x[b] = _mm_xor_si128(gf_mul_ssse3(x[b], &t[3]), h);
+    }
+    /* 1 lane per block */
+    if (m & 1)
+      x[m++] = _mm_setzero_si128();
+    h = _mm_unpacklo_epi64(_mm_shuffle_epi8(x[0], odd8), _mm_shuffle_epi8(x[1], odd8));
+    x[0] = _mm_unpacklo_epi64(_mm_shuffle_epi8(x[0], even8), _mm_shuffle_epi8(x[1], even8));
+    any = _mm_or_si128(any, _mm_xor_si128(gf_mul_ssse3(x[0], &t[4]), h));
+  }
+
+  return ~_mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) & ((1U << n) - 1);
+}
+
+#ifdef __SSSE3__
+#define batch_syndromes batch_syndromes_ssse3
+#else
+static unsigned (*batch_syndromes)(const data_t *const *blocks, int n, int len, int nroots) = batch_syndromes_scalar;
+
+/* runs before main, so before any thread can decode */
+__attribute__((constructor))
+static void select_syndromes(void){
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) {
+    syndromes = syndromes_ssse3;
+    batch_syndromes = batch_syndromes_ssse3;
+  }
+}
+#endif
+
+#elif defined(SYNDROMES_NEON)
+
+static unsigned batch_syndromes(const data_t *const *blocks, int n, int len, int nroots){
+  static const uint8_t lane_bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  uint8x16_t chunk[BATCH_MAX][MAX_CHUNKS];
+  uint8x16_t any = vdupq_n_u8(0);
+  uint8_t first[16];
+  int nchunks = (len + 15) / 16;
+  int lead = nchunks * 16 - len;
+  int i, b, q;
+
+  memset(first, 0, sizeof(first));
+  for (b = 0; b < n; b++) {
+    memcpy(first + lead, blocks[b], 16 - lead);
+    chunk[b][0] = vld1q_u8(first);
+    for (q = 1; q < nchunks; q++)
+      chunk[b][q] = vld1q_u8(blocks[b] + q * 16 - lead);
+  }
+
+  for (i = 0; i < nroots; i++) {
+    const struct gf_mul_table *t = uat_syndrome_tables[i];
+    uint8x16_t x[BATCH_MAX];
+    int m = n;
+
+    for (b = 0; b < n; b++) {
+      x[b] = chunk[b][0];
+      for (q = 1; q < nchunks; q++)
+        x[b] = veorq_u8(gf_mul_neon(x[b], &t[0]), chunk[b][q]);
+    }
+    /* the same folds as the SSSE3 version; UZP does each in one step */
+    if (m & 1)
+      x[m++] = vdupq_n_u8(0);
+    for (b = 0, m /= 2; b < m; b++) {
+      uint64x2_t lo = vreinterpretq_u64_u8(x[2*b]), hi = vreinterpretq_u64_u8(x[2*b+1]);
+      x[b] = veorq_u8(gf_mul_neon(vreinterpretq_u8_u64(vuzp1q_u64(lo, hi)), &t[1]),
+                      vreinterpretq_u8_u64(vuzp2q_u64(lo, hi)));
+    }
+    if (m & 1)
+      x[m++] = vdupq_n_u8(0);
+    for (b = 0, m /= 2; b < m; b++) {
+      uint32x4_t lo = vreinterpretq_u32_u8(x[2*b]), hi = vreinterpretq_u32_u8(x[2*b+1]);
+      x[b] = veorq_u8(gf_mul_neon(vreinterpretq_u8_u32(vuzp1q_u32(lo, hi)), &t[2]),
+                      vreinterpretq_u8_u32(vuzp2q_u32(lo, hi)));
+    }
+    if (m & 1)
+      x[m++] = vdupq_n_u8(0);
+    for (b = 0, m /= 2; b < m; b++) {
+      uint16x8_t lo = vreinterpretq_u16_u8(x[2*b]), hi = vreinterpretq_u16_u8(x[2*b+1]);
+      x[b] = veorq_u8(gf_mul_neon(vreinterpretq_u8_u16(vuzp1q_u16(lo, hi)), &t[3]),
+                      vreinterpretq_u8_u16(vuzp2q_u16(lo, hi)));
+    }
+    if (m & 1)
+      x[m++] = vdupq_n_u8(0);
+    any = vorrq_u8(any, veorq_u8(gf_mul_neon(vuzp1q_u8(x[0], x[1]), &t[4]), vuzp2q_u8(x[0], x[1])));
+  }
+
+  /* one bit per nonzero lane */
+  any = vandq_u8(vtstq_u8(any, any), vld1q_u8(lane_bits));
+  return (vaddv_u8(vget_low_u8(any)) | (unsigned) vaddv_u8(vget_high_u8(any)) << 8) & ((1U << n) - 1);
+}
+
+#else
+
+#define batch_syndromes batch_syndromes_scalar
+
+#endif
+
+unsigned uat_syndrome_mask(const data_t *const *blocks, int n, int len, int nroots){
+  unsigned mask = 0;
+  int b;
+
+  for (b = 0; b < n; b += BATCH_MAX)
+    mask |= batch_syndromes(blocks + b, n - b < BATCH_MAX ? n - b : BATCH_MAX, len, nroots) << b;
+
+  return mask;
+}
+
+#define NN 255
+#define MODNN(x) ((unsigned)(x) % 255)
+#define ALPHA_TO uat_alpha_to
+#define INDEX_OF uat_index_of
+#define FCR 120
+#define PRIM 1
+#define IPRIM 1
+#define SHORTENED
+#define SYNDROMES(data, s) syndromes(data, NN-PAD, NROOTS, s)
+
+/* ADS-B Basic UAT: 18 data + 12 parity bytes */
+#define NROOTS 12
+#define PAD 225
+int decode_rs_adsb_short(data_t *data, int *eras_pos, int no_eras){
+  int retval;
+
+#include "decode_rs.h"
+
+  return retval;
+}
+#undef NROOTS
+#undef PAD
+
+/* ADS-B Long UAT: 34 data + 14 parity bytes */
+#define NROOTS 14
+#define PAD 207
+int decode_rs_adsb_long(data_t *data, int *eras_pos, int no_eras){
+  int retval;
+
+#include "decode_rs.h"
+
+  return retval;
+}
+#undef NROOTS
+#undef PAD
+
+/* Uplink block: 72 data + 20 parity bytes */
+#define NROOTS 20
+#define PAD 163
+int decode_rs_uplink(data_t *data, int *eras_pos, int no_eras){
+  int retval;
+
+#include "decode_rs.h"
+
+  return retval;
+}
+#undef NROOTS
+#undef PAD
@@ -0,0 +1,94 @@
+/* Build-time generator for the GF(256) tables used by decode_rs_uat.c
+ * Based on init_rs.h, Copyright 2004 Phil Karn, KA9Q
+ * Copyright 2026, the dump978 contributors
+ * May be used under the terms of the GNU Lesser General Public License (LGPL)
+ *
+ * Writes a header with the antilog (ALPHA_TO) and log (INDEX_OF) tables
+ * for the UAT field generator polynomial to stdout, laid out exactly as
+ * init_rs_char() would build them at runtime, and the nibble product
+ * tables used by the SIMD syndrome kernels.
+ */
+
+#include <stdio.h>
+
+#define UAT_GFPOLY 0x187
+#define UAT_FCR 120
+#define UAT_MAX_NROOTS 20
+#define NN 255
+#define A0 NN
+
+static unsigned char alpha_to[NN + 1], index_of[NN + 1];
+
+static int gf_mul(int a, int b)
+{
+    if (a == 0 || b == 0)
+        return 0;
+    return alpha_to[(index_of[a] + index_of[b]) % NN];
+}
+
+static void print_table(const char *name, const unsigned char *table)
+{
+    int i;
+
+    printf("static const unsigned char %s[%d] = {", name, NN + 1);
+    for (i = 0; i <= NN; ++i)
+        printf("%s%3d,", (i % 12) ? " " : "\n    ", table[i]);
+    printf("\n};\n\n");
+}
+
+// Print the nibble product tables for multiplying by alpha**e:
+// lo[n] = n * alpha**e, hi[n] = (n << 4) * alpha**e
+static void print_mul_table(int e)
+{
+    int n;
+
+    printf("{ {");
+    for (n = 0; n < 16; ++n)
+        printf("%s%d", n ? "," : "", gf_mul(n, alpha_to[e % NN]));
+    printf("}, {");
+    for (n = 0; n < 16; ++n)
+        printf("%s%d", n ? "," : "", gf_mul(n << 4, alpha_to[e % NN]));
+    printf("} }");
+}
+
+int main(int argc, char **argv)
+{
+    int i, m, sr;
+
+    index_of[0] = A0;    // log(zero) = -inf
+    alpha_to[A0] = 0;    // alpha**-inf = 0
+    sr = 1;
+    for (i = 0; i < NN; ++i) {
+        index_of[sr] = i;
+        alpha_to[i] = sr;
+        sr <<= 1;
+        if (sr & (NN + 1))
+            sr ^= UAT_GFPOLY;
+        sr &= NN;
+    }
+
+    if (sr != 1) {
+        fprintf(stderr, "gen_rs_tables: field generator polynomial is not primitive\n");
+        return 1;
+    }
+
+    printf("/* GF(256) tables for the UAT Reed-Solomon codes, field generator\n"
+           " * polynomial 0x%X. Generated by gen_rs_tables.c; do not edit. */\n\n", UAT_GFPOLY);
+    print_table("uat_alpha_to", alpha_to);
+    print_table("uat_index_of", index_of);
+
+    // For root i (alpha**(FCR+i)), multipliers alpha**(k * (FCR+i)) for
+    // k = 16, 8, 4, 2, 1; see syndromes() in decode_rs_uat.c
+    printf("static const struct gf_mul_table uat_syndrome_tables[%d][5] = {\n", UAT_MAX_NROOTS);
+    for (i = 0; i < UAT_MAX_NROOTS; ++i) {
+        printf("    {\n");
+        for (m = 0; m < 5; ++m) {
+            printf("        ");
+            print_mul_table((16 >> m) * (UAT_FCR + i));
+            printf(",\n");
+        }
+        printf("    },\n");
+    }
+    printf("};\n");
+    return 0;
+}
@@ -7,8 +7,21 @@
 #define _FEC_RS_H_
 
 /* General purpose RS codec, 8-bit symbols */
+void encode_rs_char(void *rs,unsigned char *data,
+		    unsigned char *parity);
 int decode_rs_char(void *rs,unsigned char *data,int *eras_pos,
                    int no_eras);
+/* Decoders with the UAT code parameters built in (see decode_rs_uat.c).
+ * As decode_rs_char, but they only search the positions present in the
+ * shortened block; see SHORTENED in decode_rs.h */
+int decode_rs_adsb_short(unsigned char *data,int *eras_pos,int no_eras);
+int decode_rs_adsb_long(unsigned char *data,int *eras_pos,int no_eras);
+int decode_rs_uplink(unsigned char *data,int *eras_pos,int no_eras);
+/* Check 'n' (up to 32) blocks of 'len' symbols of the UAT code with
+ * 'nroots' roots at once; returns a bitmask of the blocks with nonzero
+ * syndromes, which need decoding */
+unsigned uat_syndrome_mask(const unsigned char *const *blocks,int n,
+			   int len,int nroots);
 void *init_rs_char(int symsize,int gfpoly,
                    int fcr,int prim,int nroots,
                    int pad);
@@ -0,0 +1,508 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Reed-Solomon decoder benchmark.
+//
+// For each of the three UAT codes, encode random blocks, add a given
+// number of symbol errors, and time the general purpose decoder
+// (decode_rs_char) against the specialized UAT decoders (decode_rs_uat.c).
+// Also check that the two agree: they should give identical results,
+// except that the UAT decoders reject blocks whose error locator has roots
+// in the padding, which decode_rs_char "corrects" into a wrong block.
+//
+// Then time the frame-level API (fec.h) in frames per second, correcting
+// frames one at a time against correcting them in batches of various
+// sizes, and check that both give the same results.
+//
+// Finally, sweep correct_adsb_frame() and correct_uplink_frame() over
+// whole encoded frames with 0..t+2 symbol errors, and the soft-decision
+// versions over t errors marked as erasures plus further unmarked
+// errors, reporting frames/s and ns/frame and checking that every frame
+// within the code's correction capability comes back exactly as sent.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "uat.h"
+#include "fec.h"
+#include "fec/rs.h"
+
+#define BLOCKS 2000    // distinct blocks per error count
+#define ROUNDS 10      // timed passes over them
+
+typedef int (*decoder_t)(unsigned char *data, int *eras_pos, int no_eras);
+
+static const struct {
+    const char *name;
+    int nroots;
+    int len;           // shortened block length, data + parity
+    decoder_t decode;
+} codes[] = {
+    { "ADS-B short", 12, SHORT_FRAME_BYTES,  decode_rs_adsb_short },
+    { "ADS-B long",  14, LONG_FRAME_BYTES,   decode_rs_adsb_long },
+    { "uplink",      20, UPLINK_BLOCK_BYTES, decode_rs_uplink },
+    { NULL, 0, 0, NULL }
+};
+
+// the general purpose control block for the code being tested
+static void *generic_rs;
+
+static int decode_generic(unsigned char *data, int *eras_pos, int no_eras)
+{
+    return decode_rs_char(generic_rs, data, eras_pos, no_eras);
+}
+
+static uint8_t original[BLOCKS][UPLINK_BLOCK_BYTES];
+static uint8_t received[BLOCKS][UPLINK_BLOCK_BYTES];
+static uint8_t frames[BLOCKS][UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+
+static double monotonic_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Fill original[] with random codewords and received[] with copies of
+// them with 'errors' symbols corrupted
+static void make_blocks(void *rs, int nroots, int len, int errors)
+{
+    int b, i;
+
+    for (b = 0; b < BLOCKS; ++b) {
+        for (i = 0; i < len - nroots; ++i)
+            original[b][i] = rand() & 0xFF;
+        encode_rs_char(rs, original[b], original[b] + len - nroots);
+
+        memcpy(received[b], original[b], len);
+        for (i = 0; i < errors; ++i) {
+            int pos;
+            do {
+                pos = rand() % len;
+            } while (received[b][pos] != original[b][pos]);
+            received[b][pos] ^= 1 + rand() % 255;
+        }
+    }
+}
+
+// Fill frames[] with uplink frames, 'dirty' blocks of each with errors
+// and the rest clean. Uses original[] and received[] as scratch, so call
+// with the uplink control block after the block tests.
+static void make_frames(void *rs, int dirty)
+{
+    int f, b;
+
+    make_blocks(rs, 20, UPLINK_BLOCK_BYTES, 3);
+
+    for (f = 0; f < BLOCKS; ++f) {
+        for (b = 0; b < UPLINK_FRAME_BLOCKS; ++b) {
+            int n = (f * UPLINK_FRAME_BLOCKS + b) % BLOCKS;
+            memcpy(frames[f][b], b < dirty ? received[n] : original[n], UPLINK_BLOCK_BYTES);
+        }
+    }
+}
+
+static const int batch_sizes[] = { 1, 2, 8, 32, 0 };
+#define MAX_BATCH 32
+
+static uint8_t work[MAX_BATCH][UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+static uint8_t output[MAX_BATCH][UPLINK_FRAME_BYTES];
+
+// Correct frames b..b+n-1 (received[] for ADS-B, frames[] for uplink)
+// in work[] and output[], in one batch or, if 'n' is 0, one frame at a
+// time using the single-frame functions, storing the results in 'batch'
+static void correct_frames(int uplink, int b, int n, struct fec_frame *batch)
+{
+    int i;
+
+    for (i = 0; i < (n ? n : 1); ++i) {
+        if (uplink)
+            memcpy(work[i], frames[b + i], sizeof(work[i]));
+        else
+            memcpy(work[i], received[b + i], LONG_FRAME_BYTES);
+        batch[i].data = &work[i][0][0];
+        batch[i].to = output[i];
+        batch[i].confidence = NULL;
+    }
+
+    if (n == 0) {
+        if (uplink)
+            batch[0].frametype = correct_uplink_blocks(work[0], NULL, output[0], 0, &batch[0].rs_errors);
+        else
+            batch[0].frametype = correct_adsb_frame(&work[0][0][0], &batch[0].rs_errors);
+    } else if (uplink) {
+        correct_uplink_frames(batch, n, 0);
+    } else {
+        correct_adsb_frames(batch, n, 0);
+    }
+}
+
+// Time correct_frames over all the frames in batches of 'n' (0 for one
+// at a time, unbatched); returns frames per second
+static double time_batches(int uplink, int n)
+{
+    struct fec_frame batch[MAX_BATCH];
+    int step = (n ? n : 1);
+    double start = monotonic_seconds();
+    int r, b;
+
+    for (r = 0; r < ROUNDS; ++r)
+        for (b = 0; b + step <= BLOCKS; b += step)
+            correct_frames(uplink, b, n, batch);
+
+    return ROUNDS * (BLOCKS / step * step) / (monotonic_seconds() - start);
+}
+
+// Check that batches of 'n' give the same results as one frame at a time
+static int check_batches(const char *name, int uplink, int n)
+{
+    static uint8_t expected[MAX_BATCH][UPLINK_FRAME_BYTES];
+    struct fec_frame single, batch[MAX_BATCH];
+    int len = (uplink ? UPLINK_FRAME_DATA_BYTES : LONG_FRAME_BYTES);
+    int b, i, ok = 1;
+
+    for (b = 0; b + n <= BLOCKS; b += n) {
+        correct_frames(uplink, b, n, batch);
+        for (i = 0; i < n; ++i)
+            memcpy(expected[i], uplink ? output[i] : &work[i][0][0], len);
+
+        // one at a time reuses work[0] and output[0]
+        for (i = 0; i < n; ++i) {
+            correct_frames(uplink, b + i, 0, &single);
+            if (single.frametype != batch[i].frametype ||
+                (single.frametype > 0 && (single.rs_errors != batch[i].rs_errors ||
+                                          memcmp(expected[i], uplink ? output[0] : &work[0][0][0], len)))) {
+                fprintf(stderr, "%s, batch of %d, frame %d: batch and single results differ\n", name, n, b + i);
+                ok = 0;
+            }
+        }
+    }
+
+    return ok;
+}
+
+//
+// Frame sweep.
+//
+
+#define FRAMES 1000       // distinct frames per error count
+#define FRAME_ROUNDS 3    // timed passes over them
+
+typedef enum { SWEEP_SHORT, SWEEP_LONG, SWEEP_UPLINK } sweep_kind_t;
+
+static const struct {
+    const char *name;
+    int nroots;
+    int blocks;         // interleaved blocks per frame
+    int block_bytes;    // data + parity per block
+    int data_bytes;     // data per block
+} sweeps[] = {
+    { "ADS-B short", 12, 1, SHORT_FRAME_BYTES, SHORT_FRAME_DATA_BYTES },
+    { "ADS-B long",  14, 1, LONG_FRAME_BYTES, LONG_FRAME_DATA_BYTES },
+    { "uplink",      20, UPLINK_FRAME_BLOCKS, UPLINK_BLOCK_BYTES, UPLINK_BLOCK_DATA_BYTES },
+};
+
+static uint8_t sent[FRAMES][UPLINK_FRAME_BYTES];
+static uint8_t corrupted[FRAMES][UPLINK_FRAME_BYTES];
+static uint16_t confidence[FRAMES][UPLINK_FRAME_BYTES];
+
+// Encode FRAMES random frames of the given kind into sent[], and copy
+// them to corrupted[] with 'errors' random symbol errors in each block,
+// the first 'erasures' of which are marked as low confidence
+static void make_sweep_frames(sweep_kind_t kind, void *rs, int errors, int erasures)
+{
+    int blocks = sweeps[kind].blocks;
+    int len = sweeps[kind].block_bytes;
+    int data_len = len - sweeps[kind].nroots;
+    int f, b, i;
+
+    for (f = 0; f < FRAMES; ++f) {
+        // ADS-B frames are followed by whatever comes next; fill the
+        // rest of a short frame's buffer with noise
+        for (i = 0; i < UPLINK_FRAME_BYTES; ++i) {
+            sent[f][i] = rand() & 0xFF;
+            confidence[f][i] = 1000;
+        }
+
+        // the frame type in the first 5 bits must match the length
+        if (kind == SWEEP_SHORT)
+            sent[f][0] &= 0x07;
+        else if (kind == SWEEP_LONG && (sent[f][0] >> 3) == 0)
+            sent[f][0] |= 0x08;
+
+        for (b = 0; b < blocks; ++b) {
+            uint8_t block[UPLINK_BLOCK_BYTES];
+
+            for (i = 0; i < data_len; ++i)
+                block[i] = sent[f][i * blocks + b];
+            encode_rs_char(rs, block, block + data_len);
+            for (i = data_len; i < len; ++i)
+                sent[f][i * blocks + b] = block[i];
+        }
+
+        memcpy(corrupted[f], sent[f], UPLINK_FRAME_BYTES);
+        for (b = 0; b < blocks; ++b) {
+            for (i = 0; i < errors; ++i) {
+                int pos;
+                do {
+                    pos = (rand() % len) * blocks + b;
+                } while (corrupted[f][pos] != sent[f][pos]);
+                corrupted[f][pos] ^= 1 + rand() % 255;
+                if (i < erasures)
+                    confidence[f][pos] = 0;
+            }
+        }
+    }
+}
+
+// Correct frame 'f' of corrupted[] with the frame-level API into 'out'
+// (soft-decision if 'soft'); returns 1 if it came back as sent, 0 if
+// correction failed, -1 if it "succeeded" with the wrong data
+static int correct_sweep_frame(sweep_kind_t kind, int f, int soft, uint8_t *out)
+{
+    int rs_errors, frametype, b, i;
+
+    if (kind == SWEEP_UPLINK) {
+        uint8_t in[UPLINK_FRAME_BYTES];
+
+        memcpy(in, corrupted[f], UPLINK_FRAME_BYTES);
+        if (soft)
+            frametype = correct_uplink_frame_soft(in, confidence[f], out, 1, &rs_errors);
+        else
+            frametype = correct_uplink_frame(in, out, &rs_errors);
+        if (frametype < 0)
+            return 0;
+
+        for (b = 0; b < UPLINK_FRAME_BLOCKS; ++b)
+            for (i = 0; i < UPLINK_BLOCK_DATA_BYTES; ++i)
+                if (out[b * UPLINK_BLOCK_DATA_BYTES + i] != sent[f][i * UPLINK_FRAME_BLOCKS + b])
+                    return -1;
+        return 1;
+    }
+
+    memcpy(out, corrupted[f], LONG_FRAME_BYTES);
+    if (soft)
+        frametype = correct_adsb_frame_soft(out, confidence[f], 1, &rs_errors);
+    else
+        frametype = correct_adsb_frame(out, &rs_errors);
+    if (frametype < 0)
+        return 0;
+
+    if (frametype != (kind == SWEEP_SHORT ? 1 : 2) || memcmp(out, sent[f], sweeps[kind].data_bytes))
+        return -1;
+    return 1;
+}
+
+// Run one row of the sweep; returns 0 if a frame that should have been
+// corrected was not
+static int sweep_row(sweep_kind_t kind, void *rs, int errors, int erasures)
+{
+    uint8_t out[UPLINK_FRAME_BYTES];
+    int nroots = sweeps[kind].nroots;
+    int ok = 0, failed = 0, wrong = 0;
+    int correctable = (2 * (errors - erasures) + erasures <= nroots);
+    double start, rate;
+    int f, r;
+
+    make_sweep_frames(kind, rs, errors, erasures);
+
+    for (f = 0; f < FRAMES; ++f) {
+        switch (correct_sweep_frame(kind, f, erasures > 0, out)) {
+        case 1: ++ok; break;
+        case 0: ++failed; break;
+        default: ++wrong; break;
+        }
+    }
+
+    start = monotonic_seconds();
+    for (r = 0; r < FRAME_ROUNDS; ++r)
+        for (f = 0; f < FRAMES; ++f)
+            correct_sweep_frame(kind, f, erasures > 0, out);
+    rate = FRAME_ROUNDS * FRAMES / (monotonic_seconds() - start);
+
+    printf("%-12s %6d %8d %12.0f %10.0f %8d %8d %8d\n",
+           sweeps[kind].name, errors, erasures, rate, 1e9 / rate, ok, failed, wrong);
+
+    if (correctable && ok != FRAMES) {
+        fprintf(stderr, "%s, %d errors, %d erasures: %d of %d frames not corrected\n",
+                sweeps[kind].name, errors, erasures, FRAMES - ok, FRAMES);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Sweep each frame type over error and erasure counts; returns 0 on any
+// correctness failure
+static int sweep_frames(void)
+{
+    sweep_kind_t kind;
+    int all_ok = 1;
+
+    printf("\n%-12s %6s %8s %12s %10s %8s %8s %8s\n",
+           "frame", "errors", "erasures", "frames/s", "ns/frame", "ok", "failed", "wrong");
+
+    for (kind = SWEEP_SHORT; kind <= SWEEP_UPLINK; ++kind) {
+        int nroots = sweeps[kind].nroots;
+        int t = nroots / 2;
+        void *rs = init_rs_char(8, 0x187, 120, 1, nroots, 255 - sweeps[kind].block_bytes);
+        int errors;
+
+        // hard decisions: up to t errors are correctable
+        for (errors = 0; errors <= t + 2; ++errors)
+            all_ok &= sweep_row(kind, rs, errors, 0);
+
+        // erasure retries mark t bytes, leaving room for t/2 more errors
+        for (errors = t; errors <= t + t / 2 + 1; ++errors)
+            all_ok &= sweep_row(kind, rs, errors, t);
+
+        free_rs_char(rs);
+    }
+
+    return all_ok;
+}
+
+// Time 'decode' over all the received blocks; returns blocks per second
+static double time_decoder(decoder_t decode, int len)
+{
+    uint8_t work[UPLINK_BLOCK_BYTES];
+    double start = monotonic_seconds();
+    int r, b;
+
+    for (r = 0; r < ROUNDS; ++r) {
+        for (b = 0; b < BLOCKS; ++b) {
+            memcpy(work, received[b], len);
+            decode(work, NULL, 0);
+        }
+    }
+
+    return ROUNDS * BLOCKS / (monotonic_seconds() - start);
+}
+
+int main(int argc, char **argv)
+{
+    int c, all_ok = 1;
+
+    srand(978);
+
+    printf("%-12s %6s %12s %12s %8s %16s %16s\n",
+           "code", "errors", "generic/s", "uat/s", "speedup", "generic ok/bad", "uat ok/bad");
+
+    for (c = 0; codes[c].name; ++c) {
+        int nroots = codes[c].nroots;
+        int len = codes[c].len;
+        int errors;
+
+        generic_rs = init_rs_char(8, /* gfpoly */ 0x187, /* fcr */ 120, /* prim */ 1, nroots, 255 - len);
+
+        for (errors = 0; errors <= nroots / 2 + 2; ++errors) {
+            int ok_char = 0, wrong_char = 0, ok_uat = 0, wrong_uat = 0;
+            double rate_char, rate_uat;
+            int b;
+
+            make_blocks(generic_rs, nroots, len, errors);
+
+            // correctness: compare both decoders against the original
+            for (b = 0; b < BLOCKS; ++b) {
+                uint8_t a[UPLINK_BLOCK_BYTES], u[UPLINK_BLOCK_BYTES];
+                int na, nu;
+
+                memcpy(a, received[b], len);
+                memcpy(u, received[b], len);
+                na = decode_generic(a, NULL, 0);
+                nu = codes[c].decode(u, NULL, 0);
+
+                if (na >= 0) {
+                    if (!memcmp(a, original[b], len))
+                        ++ok_char;
+                    else
+                        ++wrong_char;
+                }
+
+                if (nu >= 0) {
+                    if (!memcmp(u, original[b], len))
+                        ++ok_uat;
+                    else
+                        ++wrong_uat;
+                }
+
+                // the only allowed difference is a block that the
+                // generic decoder got wrong and the UAT decoder rejected
+                if (nu >= 0 ? (na != nu || memcmp(a, u, len)) : (na >= 0 && !memcmp(a, original[b], len))) {
+                    fprintf(stderr, "%s, %d errors, block %d: decoders disagree (%d vs %d)\n",
+                            codes[c].name, errors, b, na, nu);
+                    all_ok = 0;
+                }
+            }
+
+            rate_char = time_decoder(decode_generic, len);
+            rate_uat = time_decoder(codes[c].decode, len);
+
+            printf("%-12s %6d %12.0f %12.0f %7.2fx %9d/%-6d %9d/%-6d\n",
+                   codes[c].name, errors, rate_char, rate_uat, rate_uat / rate_char,
+                   ok_char, wrong_char, ok_uat, wrong_uat);
+        }
+
+        free_rs_char(generic_rs);
+    }
+
+    printf("\n%-12s %6s %12s", "frames", "errors", "single/s");
+    for (c = 0; batch_sizes[c]; ++c)
+        printf("   batch %2d/s", batch_sizes[c]);
+    printf("\n");
+
+    for (c = 0; c < 5; ++c) {
+        static const struct {
+            const char *name;
+            int uplink;
+            int errors;     // per ADS-B frame, or number of dirty uplink blocks
+        } sets[] = {
+            { "ADS-B long", 0, 0 },
+            { "ADS-B long", 0, 3 },
+            { "uplink",     1, 0 },
+            { "uplink",     1, 1 },
+            { "uplink",     1, 6 },
+        };
+        int uplink = sets[c].uplink;
+        int n;
+
+        if (uplink) {
+            generic_rs = init_rs_char(8, 0x187, 120, 1, 20, 255 - UPLINK_BLOCK_BYTES);
+            make_frames(generic_rs, sets[c].errors);
+        } else {
+            generic_rs = init_rs_char(8, 0x187, 120, 1, 14, 255 - LONG_FRAME_BYTES);
+            make_blocks(generic_rs, 14, LONG_FRAME_BYTES, sets[c].errors);
+        }
+        free_rs_char(generic_rs);
+
+        printf("%-12s %6d %12.0f", sets[c].name, sets[c].errors, time_batches(uplink, 0));
+        for (n = 0; batch_sizes[n]; ++n) {
+            if (!check_batches(sets[c].name, uplink, batch_sizes[n]))
+                all_ok = 0;
+            printf(" %12.0f", time_batches(uplink, batch_sizes[n]));
+        }
+        printf("\n");
+    }
+
+    if (!sweep_frames())
+        all_ok = 0;
+
+    return all_ok ? 0 : 1;
+}
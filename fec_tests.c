@@ -24,6 +24,7 @@
 
 #include "uat.h"
 #include "fec.h"
+#include "fec/rs.h"
 
 // Test data from DO-282B:
 //  Table 2-104 "ADS-B Message Reception - Set 1"
@@ -178,6 +179,142 @@ static void hex_to_bytes(const char *s, uint8_t *to)
         *to++ = (uint8_t) hexbyte(s);
 }
 
+// Uplink frames: DO-282B has no uplink vectors, so encode random blocks
+// and corrupt them. Frames cycle through clean, correctable (up to the
+// full 10 errors in a block) and uncorrectable (one block with too many
+// errors) cases, enough of them to fill several syndrome batches.
+#define UPLINK_TEST_FRAMES 16
+#define UPLINK_BLOCK_MAX_ERRORS 10
+#define UPLINK_TEST_BATCH 5 // frames per syndrome check, as in correct_uplink_frames
+
+static int uplink_block_errors(int frame, int block)
+{
+    switch (frame % 4) {
+    case 0:
+        return 0;
+    case 1:
+        return block * 2;
+    case 2:
+        return (block == frame % UPLINK_FRAME_BLOCKS) ? UPLINK_BLOCK_MAX_ERRORS : 0;
+    default:
+        return (block == 3) ? UPLINK_BLOCK_MAX_ERRORS + 6 : block;
+    }
+}
+
+static int test_uplink(void)
+{
+    static uint8_t original[UPLINK_TEST_FRAMES][UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+    static uint8_t received[UPLINK_TEST_FRAMES][UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+    static uint8_t blocks[UPLINK_TEST_FRAMES][UPLINK_FRAME_BLOCKS][UPLINK_BLOCK_BYTES];
+    static uint8_t interleaved[UPLINK_FRAME_BYTES];
+    static uint8_t to[UPLINK_TEST_FRAMES][UPLINK_FRAME_BYTES];
+    static uint8_t single_to[UPLINK_FRAME_BYTES];
+    struct fec_frame frames[UPLINK_TEST_FRAMES];
+    const unsigned char *data[UPLINK_TEST_BATCH * UPLINK_FRAME_BLOCKS];
+    void *rs = init_rs_char(8, 0x187, 120, 1, 20, 255 - UPLINK_BLOCK_BYTES);
+    int f, block, i, n;
+    int all_ok = 1;
+
+    srand(978);
+    for (f = 0; f < UPLINK_TEST_FRAMES; ++f) {
+        for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block) {
+            uint8_t *b = original[f][block];
+
+            for (i = 0; i < UPLINK_BLOCK_DATA_BYTES; ++i)
+                b[i] = rand() & 0xFF;
+            encode_rs_char(rs, b, b + UPLINK_BLOCK_DATA_BYTES);
+
+            memcpy(received[f][block], b, UPLINK_BLOCK_BYTES);
+            for (i = 0; i < uplink_block_errors(f, block); ++i) {
+                int pos;
+                do {
+                    pos = rand() % UPLINK_BLOCK_BYTES;
+                } while (received[f][block][pos] != b[pos]);
+                received[f][block][pos] ^= 1 + rand() % 255;
+            }
+        }
+    }
+    free_rs_char(rs);
+    memcpy(blocks, received, sizeof(blocks));
+
+    // the syndrome check on its own, a batch at a time
+    for (f = 0; f < UPLINK_TEST_FRAMES; f += UPLINK_TEST_BATCH) {
+        int count = (UPLINK_TEST_FRAMES - f < UPLINK_TEST_BATCH ? UPLINK_TEST_FRAMES - f : UPLINK_TEST_BATCH);
+        unsigned expected = 0, dirty;
+
+        for (n = 0; n < count * UPLINK_FRAME_BLOCKS; ++n) {
+            data[n] = received[f + n / UPLINK_FRAME_BLOCKS][n % UPLINK_FRAME_BLOCKS];
+            if (uplink_block_errors(f + n / UPLINK_FRAME_BLOCKS, n % UPLINK_FRAME_BLOCKS) > 0)
+                expected |= 1U << n;
+        }
+
+        dirty = uat_syndrome_mask(data, count * UPLINK_FRAME_BLOCKS, UPLINK_BLOCK_BYTES, 20);
+        if (dirty != expected) {
+            fprintf(stderr, "uplink syndromes, frames %d-%d: FAIL: expected mask %08x, got %08x\n",
+                    f, f + count - 1, expected, dirty);
+            all_ok = 0;
+        } else {
+            fprintf(stderr, "uplink syndromes, frames %d-%d: PASS\n", f, f + count - 1);
+        }
+    }
+
+    for (f = 0; f < UPLINK_TEST_FRAMES; ++f) {
+        frames[f].data = &blocks[f][0][0];
+        frames[f].to = to[f];
+        frames[f].confidence = NULL;
+    }
+    correct_uplink_frames(frames, UPLINK_TEST_FRAMES, 0);
+
+    for (f = 0; f < UPLINK_TEST_FRAMES; ++f) {
+        int expected_type = 1, expected_errors = 0;
+        int frametype, rs_errors;
+        int ok = 1;
+
+        for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block) {
+            if (uplink_block_errors(f, block) > UPLINK_BLOCK_MAX_ERRORS)
+                expected_type = -1;
+            expected_errors += uplink_block_errors(f, block);
+        }
+        if (expected_type < 0)
+            expected_errors = 9999;
+
+        fprintf(stderr, "uplink frame %d (%s): ", f, expected_type < 0 ? "uncorrectable" : "correctable");
+
+        if (frames[f].frametype != expected_type || frames[f].rs_errors != expected_errors) {
+            fprintf(stderr, "FAIL: expected frametype %d with %d errors, got frametype %d with %d errors\n",
+                    expected_type, expected_errors, frames[f].frametype, frames[f].rs_errors);
+            ok = 0;
+        } else if (expected_type > 0) {
+            for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block) {
+                if (memcmp(to[f] + block * UPLINK_BLOCK_DATA_BYTES, original[f][block], UPLINK_BLOCK_DATA_BYTES) != 0) {
+                    fprintf(stderr, "FAIL: wrong corrected output in block %d\n", block);
+                    ok = 0;
+                    break;
+                }
+            }
+        }
+
+        // the single-frame path, from the interleaved frame, must agree
+        for (block = 0; block < UPLINK_FRAME_BLOCKS; ++block)
+            for (i = 0; i < UPLINK_BLOCK_BYTES; ++i)
+                interleaved[i * UPLINK_FRAME_BLOCKS + block] = received[f][block][i];
+
+        frametype = correct_uplink_frame(interleaved, single_to, &rs_errors);
+        if (ok && (frametype != frames[f].frametype || rs_errors != frames[f].rs_errors ||
+                   (frametype > 0 && memcmp(single_to, to[f], UPLINK_FRAME_DATA_BYTES) != 0))) {
+            fprintf(stderr, "FAIL: correct_uplink_frame differs from the batch\n");
+            ok = 0;
+        }
+
+        if (ok)
+            fprintf(stderr, "PASS\n");
+        else
+            all_ok = 0;
+    }
+
+    return all_ok;
+}
+
 int main(int argc, char **argv)
 {
     int i;
@@ -185,15 +322,21 @@ int main(int argc, char **argv)
     uint8_t expected[LONG_FRAME_DATA_BYTES];
     int all_ok = 1;
 
-    init_fec();
-    
     for (i = 0; downlink_tests[i].testname; ++i) {
+        uint8_t batch_input[LONG_FRAME_BYTES];
+        struct fec_frame batch;
         int rs_errors;
         int frametype;
         int ok = 1;
 
         fprintf(stderr, "%s: ", downlink_tests[i].testname);
 
+        // the batch path, with its syndrome checks, must agree
+        hex_to_bytes(downlink_tests[i].input, batch_input);
+        batch.data = batch_input;
+        batch.confidence = NULL;
+        correct_adsb_frames(&batch, 1, 0);
+
         hex_to_bytes(downlink_tests[i].input, input);
         frametype = correct_adsb_frame(input, &rs_errors);
         if (frametype != downlink_tests[i].frametype) {
@@ -207,11 +350,99 @@ int main(int argc, char **argv)
             }
         }
 
+        if (batch.frametype != frametype || batch.rs_errors != rs_errors ||
+            (frametype > 0 && memcmp(batch_input, input, (frametype == 2) ? LONG_FRAME_BYTES : SHORT_FRAME_BYTES) != 0)) {
+            fprintf(stderr, "FAIL: batch differs from correct_adsb_frame\n");
+            ok = 0;
+        }
+
         if (ok)
             fprintf(stderr, "PASS\n");
         else
             all_ok = 0;
     }
-    
+
+    // Erasure retries: take each frame that should decode, correct it, then
+    // corrupt more bytes than plain decoding can fix, marking those bytes
+    // as the least confident ones.
+    for (i = 0; downlink_tests[i].testname; ++i) {
+        uint16_t confidence[LONG_FRAME_BYTES];
+        uint8_t batch_input[LONG_FRAME_BYTES];
+        uint8_t retry_input[LONG_FRAME_BYTES];
+        struct fec_frame batch;
+        int rs_errors;
+        int frametype = downlink_tests[i].frametype;
+        int len, bad, changed, j;
+        int ok = 1;
+
+        if (frametype < 0)
+            continue;
+
+        fprintf(stderr, "%s with erasures: ", downlink_tests[i].testname);
+
+        hex_to_bytes(downlink_tests[i].input, input);
+        correct_adsb_frame(input, &rs_errors);
+
+        len = (frametype == 2) ? LONG_FRAME_BYTES : SHORT_FRAME_BYTES;
+        bad = ((frametype == 2) ? 14 : 12) / 2 + 2;
+
+        for (j = 0; j < LONG_FRAME_BYTES; ++j)
+            confidence[j] = 1000;
+        for (j = 0; j < bad; ++j) {
+            // leave the first byte (and so the frame type) alone
+            int pos = 1 + j * (len - 1) / bad;
+            input[pos] ^= 0x5A;
+            confidence[pos] = j;
+        }
+
+        // the same through a batch that fails, then a retry
+        memcpy(batch_input, input, LONG_FRAME_BYTES);
+        batch.data = batch_input;
+        batch.confidence = NULL;
+        correct_adsb_frames(&batch, 1, 0);
+
+        // what the retries start from: a failed plain decode can still
+        // leave a short-code correction behind
+        memcpy(retry_input, input, LONG_FRAME_BYTES);
+        correct_adsb_frame(retry_input, &rs_errors);
+
+        frametype = correct_adsb_frame_soft(input, confidence, 3, &rs_errors);
+        if (frametype != downlink_tests[i].frametype) {
+            fprintf(stderr, "FAIL: expected frametype %d, got frametype %d\n", downlink_tests[i].frametype, frametype);
+            ok = 0;
+        } else {
+            hex_to_bytes(downlink_tests[i].expected, expected);
+            if (memcmp(expected, input, (frametype == 2) ? LONG_FRAME_DATA_BYTES : SHORT_FRAME_DATA_BYTES) != 0) {
+                fprintf(stderr, "FAIL: wrong corrected output\n");
+                ok = 0;
+            } else {
+                // erasures that were already right must not be counted
+                for (j = 0, changed = 0; j < len; ++j)
+                    changed += (retry_input[j] != input[j]);
+                if (rs_errors != changed) {
+                    fprintf(stderr, "FAIL: expected %d corrected errors, got %d\n", changed, rs_errors);
+                    ok = 0;
+                }
+            }
+        }
+
+        if (batch.frametype >= 0) {
+            fprintf(stderr, "FAIL: batch corrected a frame with too many errors\n");
+            ok = 0;
+        } else if (retry_adsb_frame(&batch, confidence, 3) != frametype || batch.rs_errors != rs_errors ||
+                   memcmp(batch_input, input, len) != 0) {
+            fprintf(stderr, "FAIL: batch retry differs from correct_adsb_frame_soft\n");
+            ok = 0;
+        }
+
+        if (ok)
+            fprintf(stderr, "PASS\n");
+        else
+            all_ok = 0;
+    }
+
+    if (!test_uplink())
+        all_ok = 0;
+
     return all_ok ? 0 : 1;
 }
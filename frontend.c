@@ -0,0 +1,433 @@
+//
+// Copyright 2015, Oliver Jowett <oliver@mutability.co.uk>
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "frontend.h"
+#include "stats.h"
+#include "frontend_tables.h" // iqphase, generated by gen_tables.c
+
+// relying on signed overflow is theoretically bad. Let's do it properly.
+
+#ifdef USE_SIGNED_OVERFLOW
+#define phi_difference(from,to) ((int16_t)((to) - (from)))
+#else
+static inline int16_t phi_difference(uint16_t from, uint16_t to)
+{
+    int32_t difference = to - from; // lies in the range -65535 .. +65535
+    if (difference >= 32768)        //   +32768..+65535
+        return difference - 65536;  //   -> -32768..-1: always in range
+    else if (difference < -32768)   //   -65535..-32769
+        return difference + 65536;  //   -> +1..32767: always in range
+    else
+        return difference;
+}
+#endif
+
+// iqphase is indexed by the I/Q pair read as a little-endian uint16
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define IQ_INDEX(iq) ((uint16_t) ((iq) << 8 | (iq) >> 8))
+#else
+#define IQ_INDEX(iq) (iq)
+#endif
+
+static void convert_to_phi(uint16_t *dest, const uint16_t *src, int n)
+{
+    int i;
+
+    // unroll the loop. n is always > 2048, usually 36864
+    for (i = 0; i+8 <= n; i += 8) {
+        dest[i] = iqphase[IQ_INDEX(src[i])];
+        dest[i+1] = iqphase[IQ_INDEX(src[i+1])];
+        dest[i+2] = iqphase[IQ_INDEX(src[i+2])];
+        dest[i+3] = iqphase[IQ_INDEX(src[i+3])];
+        dest[i+4] = iqphase[IQ_INDEX(src[i+4])];
+        dest[i+5] = iqphase[IQ_INDEX(src[i+5])];
+        dest[i+6] = iqphase[IQ_INDEX(src[i+6])];
+        dest[i+7] = iqphase[IQ_INDEX(src[i+7])];
+    }
+    for (; i < n; ++i)
+        dest[i] = iqphase[IQ_INDEX(src[i])];
+}
+
+// Compute the phase difference between each pair of adjacent
+// samples: dest[i] = phi[i+1] - phi[i] for 0 <= i < n.
+// Reads phi[0] .. phi[n].
+//
+// Because phase wraps at 65536, the difference is just a 16-bit
+// wrapping subtraction, which vectorizes trivially.
+static void phi_to_dphi(int16_t *dest, const uint16_t *phi, int n)
+{
+    int i = 0;
+
+#if defined(__AVX2__)
+    for (; i+16 <= n; i += 16) {
+        __m256i from = _mm256_loadu_si256((__m256i *) (phi + i));
+        __m256i to = _mm256_loadu_si256((__m256i *) (phi + i + 1));
+        _mm256_storeu_si256((__m256i *) (dest + i), _mm256_sub_epi16(to, from));
+    }
+#endif
+
+#if defined(__SSE2__)
+    for (; i+8 <= n; i += 8) {
+        __m128i from = _mm_loadu_si128((__m128i *) (phi + i));
+        __m128i to = _mm_loadu_si128((__m128i *) (phi + i + 1));
+        _mm_storeu_si128((__m128i *) (dest + i), _mm_sub_epi16(to, from));
+    }
+#elif defined(__ARM_NEON)
+    for (; i+8 <= n; i += 8) {
+        uint16x8_t from = vld1q_u16(phi + i);
+        uint16x8_t to = vld1q_u16(phi + i + 1);
+        vst1q_s16(dest + i, vreinterpretq_s16_u16(vsubq_u16(to, from)));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dest[i] = phi_difference(phi[i], phi[i+1]);
+}
+
+// Table-based discriminator: look up the phase of each sample in iqphase,
+// then take differences. Works through a small on-stack phase buffer so
+// only the dphi array needs to be kept between stages.
+static void table_to_dphi(int16_t *dest, const uint16_t *src, int n)
+{
+    uint16_t phi[257];
+
+    while (n > 0) {
+        int chunk = (n < 256 ? n : 256);
+
+        convert_to_phi(phi, src, chunk + 1);
+        phi_to_dphi(dest, phi, chunk);
+
+        dest += chunk;
+        src += chunk;
+        n -= chunk;
+    }
+}
+
+// Direct (table-free) discriminator.
+//
+// The phase step between samples z0 and z1 is arg(z1 * conj(z0)), so
+// we form the cross product (imaginary part) and dot product (real part)
+// of each adjacent pair and take atan2 of those. This avoids the random
+// gather into the 128kB iqphase table for every sample, which is
+// expensive on small cores with small caches.
+//
+// atan2 is approximated by the usual odd polynomial in min/max over
+// the first octant (max error ~1e-5 rad, well under one output unit),
+// then folded out to the full circle. Samples are centered as 2*x-255 so
+// all products are exact integers; this never produces a zero vector.
+//
+// The result is scaled to the same units as the table discriminator
+// (65536 per 2*pi), so the rest of the demodulator is unchanged.
+
+#define ATAN_SCALE (32768.0f / (float)M_PI)
+#define ATAN_C1 (ATAN_SCALE)
+#define ATAN_C3 (-0.327622764f * ATAN_SCALE)
+#define ATAN_C5 (0.15931422f * ATAN_SCALE)
+#define ATAN_C7 (-0.0464964749f * ATAN_SCALE)
+
+static inline int16_t direct_dphi(const uint8_t *iq)
+{
+    int i0 = 2 * iq[0] - 255, q0 = 2 * iq[1] - 255;
+    int i1 = 2 * iq[2] - 255, q1 = 2 * iq[3] - 255;
+    float re = (float) (i0 * i1 + q0 * q1);
+    float im = (float) (i0 * q1 - q0 * i1);
+    float ax = fabsf(re), ay = fabsf(im);
+    float a, s, r;
+
+    a = (ax > ay ? ay / ax : ax / ay);
+    s = a * a;
+    r = a * (ATAN_C1 + s * (ATAN_C3 + s * (ATAN_C5 + s * ATAN_C7)));
+    if (ay > ax)
+        r = 16384.0f - r;
+    if (re < 0)
+        r = 32768.0f - r;
+    if (im < 0)
+        r = -r;
+
+    r = roundf(r);
+    return (r > 32767.0f ? 32767 : (int16_t) r);
+}
+
+#if defined(__SSE2__)
+// four lanes of the direct discriminator; see direct_dphi() above
+static inline __m128 direct_atan2_ps(__m128 im, __m128 re)
+{
+    const __m128 signmask = _mm_set1_ps(-0.0f);
+    __m128 ax = _mm_andnot_ps(signmask, re);
+    __m128 ay = _mm_andnot_ps(signmask, im);
+    __m128 a, s, r, mask;
+
+    // a true divide, so that every lane matches direct_dphi() exactly
+    a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(ax, ay));
+    s = _mm_mul_ps(a, a);
+
+    r = _mm_add_ps(_mm_set1_ps(ATAN_C5), _mm_mul_ps(s, _mm_set1_ps(ATAN_C7)));
+    r = _mm_add_ps(_mm_set1_ps(ATAN_C3), _mm_mul_ps(s, r));
+    r = _mm_add_ps(_mm_set1_ps(ATAN_C1), _mm_mul_ps(s, r));
+    r = _mm_mul_ps(a, r);
+
+    mask = _mm_cmpgt_ps(ay, ax);
+    r = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(_mm_set1_ps(16384.0f), r)), _mm_andnot_ps(mask, r));
+    mask = _mm_cmplt_ps(re, _mm_setzero_ps());
+    r = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(_mm_set1_ps(32768.0f), r)), _mm_andnot_ps(mask, r));
+
+    // r >= 0 here, so copying the sign bit of im negates it when im < 0
+    return _mm_or_ps(r, _mm_and_ps(signmask, im));
+}
+
+// round to nearest (half away from zero, as roundf) and convert to int32.
+// Adding 0.5 before truncating would round up values just below 0.5.
+static inline __m128i direct_round_epi32(__m128 r)
+{
+    const __m128 signmask = _mm_set1_ps(-0.0f);
+    __m128i t = _mm_cvttps_epi32(r);
+    __m128 frac = _mm_andnot_ps(signmask, _mm_sub_ps(r, _mm_cvtepi32_ps(t)));   // exact
+    __m128i away = _mm_castps_si128(_mm_cmpge_ps(frac, _mm_set1_ps(0.5f)));
+    __m128i step = _mm_or_si128(_mm_srai_epi32(_mm_castps_si128(r), 31), _mm_set1_epi32(1));   // +1 or -1
+
+    return _mm_add_epi32(t, _mm_and_si128(away, step));
+}
+#elif defined(__ARM_NEON)
+// four lanes of the direct discriminator; see direct_dphi() above
+static inline float32x4_t direct_atan2_f32(float32x4_t im, float32x4_t re)
+{
+    float32x4_t ax = vabsq_f32(re);
+    float32x4_t ay = vabsq_f32(im);
+    float32x4_t mx = vmaxq_f32(ax, ay);
+    float32x4_t mn = vminq_f32(ax, ay);
+    float32x4_t a, s, r;
+    uint32x4_t signmask = vdupq_n_u32(0x80000000);
+
+#if defined(__aarch64__)
+    a = vdivq_f32(mn, mx);
+#else
+    // no divide on 32-bit NEON: reciprocal estimate plus two Newton steps
+    float32x4_t inv = vrecpeq_f32(mx);
+    inv = vmulq_f32(inv, vrecpsq_f32(mx, inv));
+    inv = vmulq_f32(inv, vrecpsq_f32(mx, inv));
+    a = vmulq_f32(mn, inv);
+#endif
+    s = vmulq_f32(a, a);
+
+    r = vmlaq_f32(vdupq_n_f32(ATAN_C5), s, vdupq_n_f32(ATAN_C7));
+    r = vmlaq_f32(vdupq_n_f32(ATAN_C3), s, r);
+    r = vmlaq_f32(vdupq_n_f32(ATAN_C1), s, r);
+    r = vmulq_f32(a, r);
+
+    r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(16384.0f), r), r);
+    r = vbslq_f32(vcltq_f32(re, vdupq_n_f32(0)), vsubq_f32(vdupq_n_f32(32768.0f), r), r);
+
+    // r >= 0 here, so copying the sign bit of im negates it when im < 0
+    return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(r),
+                                           vandq_u32(vreinterpretq_u32_f32(im), signmask)));
+}
+
+// round to nearest (half away from zero, as roundf) and convert to int32
+static inline int32x4_t direct_round_s32(float32x4_t r)
+{
+#if defined(__aarch64__)
+    return vcvtaq_s32_f32(r);
+#else
+    // as direct_round_epi32(); adding 0.5 before truncating would round
+    // up values just below 0.5
+    int32x4_t t = vcvtq_s32_f32(r);
+    uint32x4_t away = vcgeq_f32(vabsq_f32(vsubq_f32(r, vcvtq_f32_s32(t))), vdupq_n_f32(0.5f));
+    int32x4_t step = vorrq_s32(vshrq_n_s32(vreinterpretq_s32_f32(r), 31), vdupq_n_s32(1));
+    return vaddq_s32(t, vandq_s32(vreinterpretq_s32_u32(away), step));
+#endif
+}
+#endif
+
+// Compute dest[i] = phase step from sample i to sample i+1, 0 <= i < n.
+// Reads samples 0 .. n, i.e. iq[0] .. iq[2*n+1].
+static void direct_to_dphi(int16_t *dest, const uint8_t *iq, int n)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi16(255);
+    const __m128i odd = _mm_set_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+
+    for (; i+4 <= n; i += 4) {
+        // samples i..i+3 and i+1..i+4 as (2x-255) int16 I,Q pairs
+        __m128i z0 = _mm_loadl_epi64((__m128i *) (iq + 2*i));
+        __m128i z1 = _mm_loadl_epi64((__m128i *) (iq + 2*i + 2));
+        __m128i z1swap;
+        __m128 re, im;
+
+        z0 = _mm_sub_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(z0, _mm_setzero_si128()), 1), bias);
+        z1 = _mm_sub_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(z1, _mm_setzero_si128()), 1), bias);
+
+        // (q1, -i1) pairs, so that madd gives i0*q1 - q0*i1
+        z1swap = _mm_shufflehi_epi16(_mm_shufflelo_epi16(z1, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1));
+        z1swap = _mm_sub_epi16(_mm_xor_si128(z1swap, odd), odd);
+
+        re = _mm_cvtepi32_ps(_mm_madd_epi16(z0, z1));
+        im = _mm_cvtepi32_ps(_mm_madd_epi16(z0, z1swap));
+
+        __m128i out = direct_round_epi32(direct_atan2_ps(im, re));
+        _mm_storel_epi64((__m128i *) (dest + i), _mm_packs_epi32(out, out));
+    }
+#elif defined(__ARM_NEON)
+    const int16x8_t bias = vdupq_n_s16(255);
+
+    for (; i+8 <= n; i += 8) {
+        // samples i..i+7 and i+1..i+8, deinterleaved into I and Q
+        uint8x8x2_t z0 = vld2_u8(iq + 2*i);
+        uint8x8x2_t z1 = vld2_u8(iq + 2*i + 2);
+        int16x8_t i0 = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(z0.val[0], 1)), bias);
+        int16x8_t q0 = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(z0.val[1], 1)), bias);
+        int16x8_t i1 = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(z1.val[0], 1)), bias);
+        int16x8_t q1 = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(z1.val[1], 1)), bias);
+        int32x4_t re_lo, re_hi, im_lo, im_hi;
+        int32x4_t out_lo, out_hi;
+
+        re_lo = vmlal_s16(vmull_s16(vget_low_s16(i0), vget_low_s16(i1)), vget_low_s16(q0), vget_low_s16(q1));
+        re_hi = vmlal_s16(vmull_s16(vget_high_s16(i0), vget_high_s16(i1)), vget_high_s16(q0), vget_high_s16(q1));
+        im_lo = vmlsl_s16(vmull_s16(vget_low_s16(i0), vget_low_s16(q1)), vget_low_s16(q0), vget_low_s16(i1));
+        im_hi = vmlsl_s16(vmull_s16(vget_high_s16(i0), vget_high_s16(q1)), vget_high_s16(q0), vget_high_s16(i1));
+
+        out_lo = direct_round_s32(direct_atan2_f32(vcvtq_f32_s32(im_lo), vcvtq_f32_s32(re_lo)));
+        out_hi = direct_round_s32(direct_atan2_f32(vcvtq_f32_s32(im_hi), vcvtq_f32_s32(re_hi)));
+        vst1q_s16(dest + i, vcombine_s16(vqmovn_s32(out_lo), vqmovn_s32(out_hi)));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dest[i] = direct_dphi(iq + 2*i);
+}
+
+void convert_to_dphi(discriminator_t discriminator, int16_t *dphi, const uint16_t *iq, int n)
+{
+    uint64_t start = stats_ticks();
+
+    switch (discriminator) {
+    case DISCRIMINATOR_DIRECT:
+        direct_to_dphi(dphi, (const uint8_t *) iq, n);
+        break;
+    case DISCRIMINATOR_TABLE:
+    default:
+        table_to_dphi(dphi, iq, n);
+        break;
+    }
+
+    stats_stage_done(STAGE_FRONTEND, start);
+    STATS_ADD(samples, n);
+}
+
+// Running energy totals.
+//
+// Each sample contributes I^2 + Q^2 with I and Q centered as (2x - 255),
+// clamped to 255^2 (i.e. full scale is a magnitude of 1.0 relative to the
+// 8-bit range, as the old magnitude table had it). energy[i] receives the
+// total *before* sample i, so the energy of samples [a, b) is
+// energy[b] - energy[a] with wrapping 32-bit arithmetic.
+uint32_t accumulate_energy(uint32_t *energy, const uint16_t *samples, int n, uint32_t total)
+{
+    const uint8_t *iq = (const uint8_t *) samples;
+    uint64_t start = stats_ticks();
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi16(255);
+    const __m128i full = _mm_set1_epi32(ENERGY_FULL_SCALE);
+    __m128i acc = _mm_set1_epi32(total);
+
+    for (; i+4 <= n; i += 4) {
+        __m128i z = _mm_loadl_epi64((const __m128i *) (iq + 2*i));
+        __m128i e, over, sum;
+
+        // madd of (I,Q) pairs with themselves gives I*I + Q*Q per sample
+        z = _mm_sub_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(z, _mm_setzero_si128()), 1), bias);
+        e = _mm_madd_epi16(z, z);
+        over = _mm_cmpgt_epi32(e, full);
+        e = _mm_or_si128(_mm_andnot_si128(over, e), _mm_and_si128(over, full));
+
+        // inclusive prefix sum across the four lanes; subtracting each
+        // sample's own energy makes it exclusive
+        sum = _mm_add_epi32(e, _mm_slli_si128(e, 4));
+        sum = _mm_add_epi32(sum, _mm_slli_si128(sum, 8));
+        _mm_storeu_si128((__m128i *) (energy + i), _mm_add_epi32(acc, _mm_sub_epi32(sum, e)));
+
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(sum, _MM_SHUFFLE(3,3,3,3)));
+    }
+
+    total = (uint32_t) _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON)
+    const int16x8_t bias = vdupq_n_s16(255);
+    const int32x4_t full = vdupq_n_s32(ENERGY_FULL_SCALE);
+    const uint32x4_t zero = vdupq_n_u32(0);
+    uint32x4_t acc = vdupq_n_u32(total);
+
+    for (; i+8 <= n; i += 8) {
+        uint8x8x2_t z = vld2_u8(iq + 2*i);
+        int16x8_t vi = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(z.val[0], 1)), bias);
+        int16x8_t vq = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(z.val[1], 1)), bias);
+        uint32x4_t e_lo, e_hi;
+
+        e_lo = vreinterpretq_u32_s32(vminq_s32(full, vmlal_s16(vmull_s16(vget_low_s16(vi), vget_low_s16(vi)),
+                                                                vget_low_s16(vq), vget_low_s16(vq))));
+        e_hi = vreinterpretq_u32_s32(vminq_s32(full, vmlal_s16(vmull_s16(vget_high_s16(vi), vget_high_s16(vi)),
+                                                                vget_high_s16(vq), vget_high_s16(vq))));
+
+        // inclusive prefix sums within each half
+        e_lo = vaddq_u32(e_lo, vextq_u32(zero, e_lo, 3));
+        e_lo = vaddq_u32(e_lo, vextq_u32(zero, e_lo, 2));
+        e_hi = vaddq_u32(e_hi, vextq_u32(zero, e_hi, 3));
+        e_hi = vaddq_u32(e_hi, vextq_u32(zero, e_hi, 2));
+
+        // make them exclusive and add the running total
+        e_hi = vaddq_u32(e_hi, vdupq_n_u32(vgetq_lane_u32(e_lo, 3)));
+        vst1q_u32(energy + i, vaddq_u32(acc, vextq_u32(zero, e_lo, 3)));
+        vst1q_u32(energy + i + 4, vaddq_u32(acc, vextq_u32(e_lo, e_hi, 3)));
+        acc = vaddq_u32(acc, vdupq_n_u32(vgetq_lane_u32(e_hi, 3)));
+    }
+
+    total = vgetq_lane_u32(acc, 0);
+#endif
+
+    for (; i < n; ++i) {
+        int x = 2 * iq[2*i] - 255, y = 2 * iq[2*i + 1] - 255;
+        int e = x*x + y*y;
+
+        energy[i] = total;
+        total += (e > ENERGY_FULL_SCALE ? ENERGY_FULL_SCALE : e);
+    }
+
+    // counted as part of the same front end call as convert_to_dphi
+    STATS_ADD(ticks[STAGE_FRONTEND], stats_ticks() - start);
+    return total;
+}
+
+// returns average signal strength (dBFS) of 'len' samples with total energy 'energy'
+float energy_to_dbfs(uint32_t energy, unsigned len)
+{
+    return 10 * log10f(energy / ((float) ENERGY_FULL_SCALE * len));
+}
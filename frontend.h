@@ -0,0 +1,60 @@
+//
+// Copyright 2015, Oliver Jowett <oliver@mutability.co.uk>
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP978_FRONTEND_H
+#define DUMP978_FRONTEND_H
+
+#include <stdint.h>
+
+// FM discriminator implementations
+typedef enum {
+    DISCRIMINATOR_TABLE,   // per-sample phase lookup table
+    DISCRIMINATOR_DIRECT   // cross/dot product + polynomial atan2, no tables
+} discriminator_t;
+
+/* Convert raw samples to phase differences.
+ *
+ * 'iq' points to n+1 samples of interleaved 8-bit unsigned I/Q data.
+ * 'dphi' receives the n phase steps between adjacent samples, i.e.
+ *   dphi[i] is the phase change from sample i to sample i+1, scaled so
+ *   that 65536 is a full turn (positive = increasing phase).
+ */
+void convert_to_dphi(discriminator_t discriminator, int16_t *dphi, const uint16_t *iq, int n);
+
+// energy of a full-scale sample, see accumulate_energy()
+#define ENERGY_FULL_SCALE 65025
+
+/* Compute running energy totals, so that the signal strength of any span
+ * of samples is a subtraction.
+ *
+ * 'iq' points to n samples of interleaved 8-bit unsigned I/Q data. Each
+ * sample's energy is I^2 + Q^2 with I and Q centered as (2x - 255),
+ * clamped to ENERGY_FULL_SCALE. energy[i] receives 'total' plus the energy
+ * of samples 0 .. i-1 (i.e. the total *before* sample i); the new total is
+ * returned, to be passed in for the next samples.
+ *
+ * Totals wrap modulo 2^32, so differences are exact for spans of fewer
+ * than 2^32 / ENERGY_FULL_SCALE (about 66000) samples.
+ */
+uint32_t accumulate_energy(uint32_t *energy, const uint16_t *iq, int n, uint32_t total);
+
+/* Return the average signal strength, in dBFS, of 'len' samples
+ * whose energy (a difference of accumulate_energy() totals) is 'energy' */
+float energy_to_dbfs(uint32_t energy, unsigned len);
+
+#endif
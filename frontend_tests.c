@@ -0,0 +1,200 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "frontend.h"
+
+#define NSAMPLES (2 * 65536)
+
+static uint32_t lcg_state = 1;
+
+static uint16_t lcg_sample(void)
+{
+    lcg_state = lcg_state * 1103515245 + 12345;
+    return (uint16_t) (lcg_state >> 16);
+}
+
+// Every sample value paired with a pseudo-random neighbour on either side
+static void make_iq(uint16_t *iq)
+{
+    int i;
+
+    for (i = 0; i < NSAMPLES; i += 2) {
+        iq[i] = (uint16_t) (i / 2);
+        iq[i + 1] = lcg_sample();
+    }
+    iq[NSAMPLES] = lcg_sample();
+}
+
+// The direct discriminator converts most of a buffer with SIMD, and the
+// last few samples (or a buffer shorter than one vector) one at a time.
+// Both must give identical results for every sample pair, whatever its
+// position.
+static int test_direct_simd_matches_scalar(void)
+{
+    static uint16_t iq[NSAMPLES + 1];
+    static int16_t simd[NSAMPLES];
+    int16_t scalar;
+    int i, bad = 0;
+
+    make_iq(iq);
+
+    convert_to_dphi(DISCRIMINATOR_DIRECT, simd, iq, NSAMPLES);
+
+    for (i = 0; i < NSAMPLES; ++i) {
+        convert_to_dphi(DISCRIMINATOR_DIRECT, &scalar, &iq[i], 1);
+        if (scalar != simd[i]) {
+            if (++bad <= 10)
+                fprintf(stderr, "  sample %d (%04X -> %04X): vector %d, scalar %d\n",
+                        i, iq[i], iq[i + 1], simd[i], scalar);
+        }
+    }
+
+    if (bad)
+        fprintf(stderr, "  %d of %d phase steps differ\n", bad, NSAMPLES);
+    return bad == 0;
+}
+
+// Lengths for the table and energy paths: shorter than any vector, odd,
+// either side of the vector widths and of the table path's 256-sample
+// chunks, and the whole buffer
+static const int lengths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 255, 256, 257, 511, 513, 1000 + 3, NSAMPLES };
+
+// The table discriminator converts the buffer in chunks, taking the
+// phase differences of each chunk with AVX2, SSE2 or NEON where built in
+// and one at a time for the rest. Both must give identical results for
+// every sample pair, whatever its position and the buffer length.
+static int test_table_simd_matches_scalar(void)
+{
+    static uint16_t iq[NSAMPLES + 1];
+    static int16_t simd[NSAMPLES];
+    int16_t scalar;
+    int l, i, bad = 0;
+
+    make_iq(iq);
+
+    for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+        int n = lengths[l];
+
+        // fresh output each time, so a short write shows up
+        memset(simd, 0x55, sizeof(simd));
+        convert_to_dphi(DISCRIMINATOR_TABLE, simd, iq, n);
+
+        for (i = 0; i < n; ++i) {
+            convert_to_dphi(DISCRIMINATOR_TABLE, &scalar, &iq[i], 1);
+            if (scalar != simd[i]) {
+                if (++bad <= 10)
+                    fprintf(stderr, "  length %d, sample %d (%04X -> %04X): vector %d, scalar %d\n",
+                            n, i, iq[i], iq[i + 1], simd[i], scalar);
+            }
+        }
+    }
+
+    if (bad)
+        fprintf(stderr, "  %d phase steps differ\n", bad);
+    return bad == 0;
+}
+
+// accumulate_energy takes prefix sums with SSE2 or NEON where built in,
+// and one sample at a time for the rest. Both must give identical totals
+// for every sample, whatever the length, including when the running
+// total wraps past 2^32 (starting just below it, and again over the
+// whole buffer, whose energy is several times 2^32).
+static int test_energy_simd_matches_scalar(void)
+{
+    static uint16_t iq[NSAMPLES + 1];
+    static uint32_t simd[NSAMPLES];
+    static const uint32_t starts[] = { 0, 12345, 0xFFFFFFFFu - 100000 };
+    uint32_t scalar, simd_total, scalar_total;
+    int l, s, i, bad = 0;
+    int wrapped = 0;
+
+    make_iq(iq);
+
+    for (s = 0; s < sizeof(starts) / sizeof(starts[0]); ++s) {
+        for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+            int n = lengths[l];
+
+            memset(simd, 0x55, sizeof(simd));
+            simd_total = accumulate_energy(simd, iq, n, starts[s]);
+
+            scalar_total = starts[s];
+            for (i = 0; i < n; ++i) {
+                uint32_t next = accumulate_energy(&scalar, &iq[i], 1, scalar_total);
+
+                if (scalar != simd[i]) {
+                    if (++bad <= 10)
+                        fprintf(stderr, "  length %d from %u, sample %d (%04X): vector %u, scalar %u\n",
+                                n, starts[s], i, iq[i], simd[i], scalar);
+                }
+                if (next < scalar_total)
+                    wrapped = 1;
+                scalar_total = next;
+            }
+
+            if (simd_total != scalar_total) {
+                if (++bad <= 10)
+                    fprintf(stderr, "  length %d from %u: vector total %u, scalar total %u\n",
+                            n, starts[s], simd_total, scalar_total);
+            }
+        }
+    }
+
+    if (!wrapped) {
+        fprintf(stderr, "  the running total never wrapped\n");
+        ++bad;
+    }
+
+    if (bad)
+        fprintf(stderr, "  %d energy totals differ\n", bad);
+    return bad == 0;
+}
+
+int main(int argc, char **argv)
+{
+    int all_ok = 1;
+
+    fprintf(stderr, "direct discriminator, vector vs scalar: ");
+    if (test_direct_simd_matches_scalar()) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        fprintf(stderr, "FAIL\n");
+        all_ok = 0;
+    }
+
+    fprintf(stderr, "table discriminator, vector vs scalar: ");
+    if (test_table_simd_matches_scalar()) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        fprintf(stderr, "FAIL\n");
+        all_ok = 0;
+    }
+
+    fprintf(stderr, "energy totals, vector vs scalar: ");
+    if (test_energy_simd_matches_scalar()) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        fprintf(stderr, "FAIL\n");
+        all_ok = 0;
+    }
+
+    return all_ok ? 0 : 1;
+}
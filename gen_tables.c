@@ -0,0 +1,99 @@
+//
+// Copyright 2015, Oliver Jowett <oliver@mutability.co.uk>
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Build-time generator for the lookup tables that would otherwise be
+// computed at startup, in the same way as fec/gen_rs_tables.c:
+//
+//   gen_tables phase  - the I/Q phase table for frontend.c
+//   gen_tables crc    - the Mode S CRC table for uat2esnt.c
+//
+// Writes a header to stdout.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Generator polynomial for the Mode S CRC:
+#define MODES_GENERATOR_POLY 0xfff409U
+
+// Phase of each 8-bit I/Q sample pair, [0, 2*pi) scaled to [0, 65536).
+// Indexed by the pair as a little-endian 16-bit value, I in the low
+// byte; frontend.c swaps the index on big-endian targets.
+static void print_phase_table(void)
+{
+    unsigned i, q;
+
+    printf("/* I/Q phase table: iqphase[i | q << 8] = atan2(q - 127.5, i - 127.5),\n"
+           " * scaled from [0, 2*pi) to [0, 65536). Generated by gen_tables.c; do not edit. */\n\n");
+    printf("static const uint16_t iqphase[65536] = {");
+
+    for (q = 0; q < 256; ++q) {
+        double d_q = (q - 127.5);
+        for (i = 0; i < 256; ++i) {
+            double d_i = (i - 127.5);
+            double ang = atan2(d_q, d_i) + M_PI; // atan2 returns [-pi..pi], normalize to [0..2*pi]
+            double scaled_ang = round(32768 * ang / M_PI);
+
+            printf("%s%u,", (i % 12) ? " " : "\n    ",
+                   scaled_ang < 0 ? 0 : scaled_ang > 65535 ? 65535 : (unsigned)scaled_ang);
+        }
+    }
+
+    printf("\n};\n");
+}
+
+// CRC values for all single-byte messages
+static void print_crc_table(void)
+{
+    int i, j;
+
+    printf("/* Mode S CRC of each single-byte message, generator polynomial 0x%X.\n"
+           " * Generated by gen_tables.c; do not edit. */\n\n", MODES_GENERATOR_POLY);
+    printf("static const uint32_t crc_table[256] = {");
+
+    for (i = 0; i < 256; ++i) {
+        uint32_t c = i << 16;
+        for (j = 0; j < 8; ++j) {
+            if (c & 0x800000)
+                c = (c<<1) ^ MODES_GENERATOR_POLY;
+            else
+                c = (c<<1);
+        }
+
+        printf("%s0x%06X,", (i % 8) ? " " : "\n    ", c & 0x00ffffff);
+    }
+
+    printf("\n};\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && !strcmp(argv[1], "phase")) {
+        print_phase_table();
+        return 0;
+    }
+
+    if (argc == 2 && !strcmp(argv[1], "crc")) {
+        print_crc_table();
+        return 0;
+    }
+
+    fprintf(stderr, "usage: %s phase|crc\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,357 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+#include "ring.h"
+
+// All positions in the raw and dphi rings are in bytes, two bytes per
+// sample, so sample N of both rings is at position N*2: dphi sample N is
+// the phase change between raw samples N and N+1. The energy ring holds
+// four-byte running energy totals, so its sample N is at position N*4.
+//
+// The raw ring is only read by the phase thread, which releases it as it
+// goes. The phase thread produces the dphi and energy rings, whose data is
+// read in place by several threads: the sync thread and the workers. Only
+// the main (output) thread releases their space, and only up to a
+// position that the sync thread has finished searching and that every job
+// issued before it has finished with. The sync thread tells the main thread
+// about such positions by sending a JOB_RELEASE marker through the same
+// job/result sequence as the real jobs.
+
+#define SAMPLE_RING_BYTES   (1 << 22)    // 2M samples, about 1 second
+#define ENERGY_RING_BYTES   (SAMPLE_RING_BYTES * 2)
+
+// samples converted per phase thread iteration
+#define PHASE_BLOCK 16384
+
+// candidate start samples searched per sync thread iteration
+#define SYNC_CHUNK 32768
+
+#if (SYNC_CHUNK + DEMOD_LOOKAHEAD) * 2 > SAMPLE_RING_BYTES
+#error "sync search window does not fit in the sample ring"
+#endif
+
+#if SYNC_CHUNK + DEMOD_LOOKAHEAD > SYNC_SCAN_MAX_SAMPLES
+#error "sync search window is too large for struct sync_scan"
+#endif
+
+#define JOB_RING_ENTRIES    64
+#define RESULT_RING_BYTES   (1 << 15)
+
+typedef enum {
+    JOB_ADSB = FRAME_ADSB,       // demodulate an ADS-B frame at 'pos'
+    JOB_UPLINK = FRAME_UPLINK,   // demodulate an uplink frame at 'pos'
+    JOB_RELEASE,                 // samples before 'pos' are no longer needed
+    JOB_END                      // end of input
+} job_kind_t;
+
+struct pipeline_job {
+    uint64_t pos;                // sample position
+    job_kind_t kind;
+    float noise_floor;           // noise floor estimate before the candidate
+};
+
+struct pipeline_result {
+    uint64_t pos;
+    job_kind_t kind;
+    int ok;
+    struct demod_result frame;
+};
+
+struct pipeline_worker {
+    pthread_t thread;
+    struct pipeline *pipeline;
+    struct ring jobs;
+    struct ring results;
+};
+
+struct pipeline {
+    input_fn_t input;
+    discriminator_t discriminator;
+    int nworkers;
+    struct squelch *squelch;
+    int fec_retries;
+
+    struct ring raw;
+    struct ring dphi;
+    struct ring energy;
+
+    pthread_t input_thread;
+    pthread_t phase_thread;
+    pthread_t sync_thread;
+    struct pipeline_worker workers[PIPELINE_MAX_WORKERS];
+};
+
+// Input: read samples into the raw ring
+static void *input_thread(void *arg)
+{
+    struct pipeline *p = arg;
+
+    for (;;) {
+        size_t avail;
+        void *buf = ring_reserve(&p->raw, 1, &avail);
+        ssize_t n;
+
+        if (avail > 65536*2)
+            avail = 65536*2;
+
+        if ((n = p->input(buf, avail)) <= 0)
+            break;
+
+        ring_commit(&p->raw, n);
+    }
+
+    ring_close(&p->raw);
+    return NULL;
+}
+
+// Phase conversion: raw ring -> dphi and energy rings
+static void *phase_thread(void *arg)
+{
+    struct pipeline *p = arg;
+    uint64_t pos = 0;    // next dphi / energy sample to produce
+    uint32_t total = 0;
+
+    for (;;) {
+        // dphi sample N needs raw samples N and N+1
+        size_t avail = ring_wait_readable(&p->raw, pos * 2, 4) / 2;
+        size_t n, space;
+        int16_t *out;
+        uint32_t *energy;
+
+        if (avail < 2)
+            break;
+
+        n = avail - 1;
+        if (n > PHASE_BLOCK)
+            n = PHASE_BLOCK;
+
+        out = ring_reserve(&p->dphi, n * 2, &space);
+        energy = ring_reserve(&p->energy, n * 4, &space);
+        convert_to_dphi(p->discriminator, out, ring_ptr(&p->raw, pos * 2), n);
+        total = accumulate_energy(energy, ring_ptr(&p->raw, pos * 2), n, total);
+        // the sync thread waits on dphi, so publish energy first
+        ring_commit(&p->energy, n * 4);
+        ring_commit(&p->dphi, n * 2);
+        pos += n;
+
+        // raw sample 'pos' is still needed for the next phase difference
+        ring_release(&p->raw, pos * 2);
+    }
+
+    ring_close(&p->energy);
+    ring_close(&p->dphi);
+    return NULL;
+}
+
+// Sync search: scan the dphi ring and issue one job per candidate,
+// round-robin across the workers.
+static void *sync_thread(void *arg)
+{
+    struct pipeline *p = arg;
+    static struct sync_scan scan;
+    uint64_t pos = 0;    // next sample to search (always even)
+    unsigned seq = 0;
+    struct pipeline_job job;
+    int i;
+
+    for (;;) {
+        size_t avail = ring_wait_readable(&p->dphi, pos * 2, (SYNC_CHUNK + DEMOD_LOOKAHEAD) * 2) / 2;
+        int last = (avail < SYNC_CHUNK + DEMOD_LOOKAHEAD);
+        int nstarts;
+        struct sync_candidate cand;
+
+        if (!last)
+            nstarts = SYNC_CHUNK / 2;
+        else // at EOF there is one more raw sample than there are dphi samples
+            nstarts = ((int)avail + 1 - DEMOD_LOOKAHEAD) / 2;
+
+        if (nstarts > 0) {
+            sync_scan_init(&scan, ring_ptr(&p->dphi, pos * 2), ring_ptr(&p->energy, pos * 4),
+                           pos, nstarts, p->squelch);
+            while (sync_scan_next(&scan, &cand)) {
+                job.pos = pos + cand.index;
+                job.kind = (job_kind_t) cand.type;
+                job.noise_floor = cand.noise_floor;
+                ring_push(&p->workers[seq++ % p->nworkers].jobs, &job, sizeof(job));
+            }
+
+            pos += nstarts * 2;
+
+            job.pos = pos;
+            job.kind = JOB_RELEASE;
+            ring_push(&p->workers[seq++ % p->nworkers].jobs, &job, sizeof(job));
+        }
+
+        if (last)
+            break;
+    }
+
+    // every worker gets an end marker, so all of them exit
+    job.pos = pos;
+    job.kind = JOB_END;
+    for (i = 0; i < p->nworkers; ++i)
+        ring_push(&p->workers[seq++ % p->nworkers].jobs, &job, sizeof(job));
+
+    return NULL;
+}
+
+// Demodulator / FEC worker
+static void *worker_thread(void *arg)
+{
+    struct pipeline_worker *w = arg;
+    struct pipeline *p = w->pipeline;
+    struct pipeline_job job;
+    struct pipeline_result result;
+
+    while (ring_pop(&w->jobs, &job, sizeof(job))) {
+        result.pos = job.pos;
+        result.kind = job.kind;
+        result.ok = 0;
+
+        if (job.kind == JOB_ADSB || job.kind == JOB_UPLINK) {
+            result.ok = demod_candidate(ring_ptr(&p->dphi, job.pos * 2),
+                                        ring_ptr(&p->energy, job.pos * 4),
+                                        (demod_frame_type_t) job.kind, p->fec_retries, &result.frame);
+            result.frame.noise_floor = job.noise_floor;
+        }
+
+        ring_push(&w->results, &result, sizeof(result));
+
+        if (job.kind == JOB_END)
+            break;
+    }
+
+    return NULL;
+}
+
+static void start_thread(pthread_t *thread, void *(*fn)(void *), void *arg)
+{
+    int err = pthread_create(thread, NULL, fn, arg);
+    if (err) {
+        fprintf(stderr, "pthread_create: %s\n", strerror(err));
+        exit(1);
+    }
+}
+
+// Initialize 'ring' and, if that succeeds, add it to rings[] so that
+// destroy_rings() cleans it up
+static int add_ring(struct ring **rings, int *nrings, struct ring *ring, size_t size)
+{
+    if (ring_init(ring, size) < 0)
+        return -1;
+
+    rings[(*nrings)++] = ring;
+    return 0;
+}
+
+static void destroy_rings(struct ring **rings, int nrings)
+{
+    while (nrings > 0)
+        ring_destroy(rings[--nrings]);
+}
+
+int pipeline_run(input_fn_t input, discriminator_t discriminator, int nworkers,
+                 struct squelch *squelch, int fec_retries, pipeline_frame_handler_t handler)
+{
+    static struct pipeline pipeline;
+    struct pipeline *p = &pipeline;
+    struct pipeline_result result;
+    uint64_t resume = 0;    // start bit following the last frame output
+    unsigned seq = 0;
+    int ends = 0;
+    struct ring *rings[3 + 2 * PIPELINE_MAX_WORKERS];
+    int nrings = 0;
+    int i;
+
+    if (nworkers < 1 || nworkers > PIPELINE_MAX_WORKERS) {
+        fprintf(stderr, "pipeline: bad worker count %d\n", nworkers);
+        return -1;
+    }
+
+    p->input = input;
+    p->discriminator = discriminator;
+    p->nworkers = nworkers;
+    p->squelch = squelch;
+    p->fec_retries = fec_retries;
+
+    if (add_ring(rings, &nrings, &p->raw, SAMPLE_RING_BYTES) < 0 ||
+        add_ring(rings, &nrings, &p->dphi, SAMPLE_RING_BYTES) < 0 ||
+        add_ring(rings, &nrings, &p->energy, ENERGY_RING_BYTES) < 0)
+        goto fail;
+
+    for (i = 0; i < nworkers; ++i) {
+        struct pipeline_worker *w = &p->workers[i];
+        w->pipeline = p;
+        if (add_ring(rings, &nrings, &w->jobs, JOB_RING_ENTRIES * sizeof(struct pipeline_job)) < 0 ||
+            add_ring(rings, &nrings, &w->results, RESULT_RING_BYTES) < 0)
+            goto fail;
+    }
+
+    start_thread(&p->input_thread, input_thread, p);
+    start_thread(&p->phase_thread, phase_thread, p);
+    start_thread(&p->sync_thread, sync_thread, p);
+    for (i = 0; i < nworkers; ++i)
+        start_thread(&p->workers[i].thread, worker_thread, &p->workers[i]);
+
+    // Collect results in the order the jobs were issued, i.e. in order of
+    // increasing candidate position. A frame found at a candidate inside
+    // the previous frame is dropped, just as the single-threaded
+    // demodulator would have skipped that candidate entirely.
+    while (ends < nworkers) {
+        ring_pop(&p->workers[seq++ % nworkers].results, &result, sizeof(result));
+
+        switch (result.kind) {
+        case JOB_ADSB:
+        case JOB_UPLINK:
+            if (result.ok && result.pos / 2 >= resume) {
+                handler(result.pos + result.frame.shift, &result.frame);
+                resume = result.pos / 2 + result.frame.bits;
+            }
+            break;
+
+        case JOB_RELEASE:
+            ring_release(&p->dphi, result.pos * 2);
+            ring_release(&p->energy, result.pos * 4);
+            break;
+
+        case JOB_END:
+            ++ends;
+            break;
+        }
+    }
+
+    pthread_join(p->input_thread, NULL);
+    pthread_join(p->phase_thread, NULL);
+    pthread_join(p->sync_thread, NULL);
+    for (i = 0; i < nworkers; ++i)
+        pthread_join(p->workers[i].thread, NULL);
+
+    destroy_rings(rings, nrings);
+    return 0;
+
+ fail:
+    perror("pipeline: ring_init");
+    destroy_rings(rings, nrings);
+    return -1;
+}
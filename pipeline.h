@@ -0,0 +1,55 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP978_PIPELINE_H
+#define DUMP978_PIPELINE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "frontend.h"
+#include "demod.h"
+
+#define PIPELINE_MAX_WORKERS 16
+
+// Reads up to 'len' bytes of samples into 'buf'; returns the number of bytes
+// read, 0 on EOF, or -1 on error (as read(2))
+typedef ssize_t (*input_fn_t)(void *buf, size_t len);
+
+// Called for each demodulated frame, in order of sample offset
+typedef void (*pipeline_frame_handler_t)(uint64_t timestamp, const struct demod_result *frame);
+
+/* Demodulate everything from 'input' using a multithreaded pipeline:
+ *
+ *   input thread   -> raw sample ring
+ *   phase thread   -> phase difference and energy rings
+ *   sync thread    -> one job per sync word candidate, round-robin to
+ *   'workers' demodulator/FEC threads -> per-worker result rings
+ *
+ * The sync thread applies 'squelch' (may be NULL) to the search and tags
+ * each frame with its noise floor estimate. Workers pass 'fec_retries' to
+ * demod_candidate().
+ * The calling thread collects results in candidate order and calls
+ * 'handler' for each frame, so output is identical to the single-threaded
+ * demodulator.
+ *
+ * Returns 0 on success, -1 if the pipeline could not be started.
+ */
+int pipeline_run(input_fn_t input, discriminator_t discriminator, int workers,
+                 struct squelch *squelch, int fec_retries, pipeline_frame_handler_t handler);
+
+#endif
@@ -22,19 +22,43 @@
 #include <unistd.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #include "uat.h"
 #include "reader.h"
 
+// Input is read into a buffer that starts at READER_BUF_MIN bytes and
+// doubles (up to READER_BUF_MAX) whenever a single line does not fit.
+// Complete lines are parsed where they lie; the partial line left at the
+// end is only moved back to the start of the buffer when there is no
+// room left after it.
+#define READER_BUF_MIN 65536
+#define READER_BUF_MAX (1024*1024)
+
 struct dump978_reader {
     int fd;
-    char buf[4096];
+    char *buf;
+    size_t size;  // allocated size of buf
+    size_t start; // start of unprocessed input in buf
+    size_t used;  // end of input in buf
     uint8_t frame[UPLINK_FRAME_DATA_BYTES]; // max uplink frame size
-    int used;
+    uint8_t *arena; // frame data for dump978_read_frame_batch
+    size_t arena_size;
 };
 
-static int process_input(struct dump978_reader *reader, frame_handler_t handler, void *handler_data);
-static int process_line(struct dump978_reader *reader, frame_handler_t handler, void *handler_data, char *p, char *end);
-static int hexbyte(char *buf);
+static ssize_t fill_buffer(struct dump978_reader *reader);
+static int process_input(struct dump978_reader *reader, frame_handler_v2_t handler, void *handler_data);
+static int process_batch(struct dump978_reader *reader, struct dump978_frame *frames, int max_frames);
+static int parse_next(char **pp, char *end, struct dump978_frame *frame, uint8_t *data, size_t max_len);
+static int parse_line(char *p, char *end, struct dump978_frame *frame, uint8_t *data, size_t max_len);
+static int parse_record(char *p, struct dump978_frame *frame);
+static void parse_metadata(const char *p, const char *end, struct dump978_metadata *meta);
+static int hex_decode(const char *hex, uint8_t *out, int len);
+static int hexbyte(const char *buf);
 
 struct dump978_reader *dump978_reader_new(int fd, int nonblock)
 {
@@ -52,14 +76,42 @@ struct dump978_reader *dump978_reader_new(int fd, int nonblock)
         }
     }
         
+    reader->buf = malloc(READER_BUF_MIN);
+    if (!reader->buf) {
+        free(reader);
+        errno = ENOMEM;
+        return NULL;
+    }
+
     reader->fd = fd;
-    reader->used = 0;
+    reader->size = READER_BUF_MIN;
+    reader->start = reader->used = 0;
     return reader;
 }
     
+// dump978_read_frames is a v2 reader with this adapter as its handler
+struct v1_adapter {
+    frame_handler_t handler;
+    void *handler_data;
+};
+
+static void v1_handler(frame_type_t t, uint8_t *f, int l, const struct dump978_metadata *m, void *d)
+{
+    struct v1_adapter *adapter = d;
+    adapter->handler(t, f, l, adapter->handler_data, m->has_signal_strength ? m->signal_strength : 0);
+}
+
 int dump978_read_frames(struct dump978_reader *reader,
                         frame_handler_t handler,
                         void *handler_data)
+{
+    struct v1_adapter adapter = { handler, handler_data };
+    return dump978_read_frames_v2(reader, v1_handler, &adapter);
+}
+
+int dump978_read_frames_v2(struct dump978_reader *reader,
+                           frame_handler_v2_t handler,
+                           void *handler_data)
 {
     int framecount = 0;
     ssize_t bytes_read;
@@ -70,18 +122,9 @@ int dump978_read_frames(struct dump978_reader *reader,
     }
 
     for (;;) {
-        if (reader->used == sizeof(reader->buf)) {
-            // line too long, ditch input
-            reader->used = 0;
-        }
-
-        bytes_read = read(reader->fd,
-                          reader->buf + reader->used,
-                          sizeof(reader->buf) - reader->used);
+        bytes_read = fill_buffer(reader);
         if (bytes_read <= 0)
             break;
-        
-        reader->used += bytes_read;
 
         framecount += process_input(reader, handler, handler_data);
     }
@@ -96,109 +139,444 @@ int dump978_read_frames(struct dump978_reader *reader,
     return -1; // propagate unexpected error
 }
 
+int dump978_read_frame_batch(struct dump978_reader *reader,
+                             struct dump978_frame *frames,
+                             int max_frames)
+{
+    ssize_t bytes_read;
+    int framecount;
+
+    if (!reader || !frames || max_frames <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Frames from the previous call are released here: the input they
+    // came from is now consumed, and the arena is overwritten.
+    for (;;) {
+        framecount = process_batch(reader, frames, max_frames);
+        if (framecount < 0)
+            return -1;
+        if (framecount > 0)
+            return framecount;
+
+        bytes_read = fill_buffer(reader);
+        if (bytes_read == 0)
+            return 0; // EOF
+        if (bytes_read < 0)
+            return -1;
+    }
+}
+
 void dump978_reader_free(struct dump978_reader *reader)
 {
     if (!reader)
         return;
 
+    free(reader->buf);
+    free(reader->arena);
     free(reader);
 }
 
-static int process_input(struct dump978_reader *reader, frame_handler_t handler, void *handler_data)
+// Read more input, first making room in the buffer if it is full.
+// Returns as for read().
+static ssize_t fill_buffer(struct dump978_reader *reader)
 {
-    char *p = reader->buf;
+    ssize_t bytes_read;
+
+    if (reader->used == reader->size) {
+        if (reader->start > 0) {
+            // make room by moving the partial line to the start
+            reader->used -= reader->start;
+            memmove(reader->buf, reader->buf + reader->start, reader->used);
+            reader->start = 0;
+        } else if (reader->size < READER_BUF_MAX) {
+            // the buffer holds one partial line; grow it
+            char *newbuf = realloc(reader->buf, reader->size * 2);
+            if (!newbuf)
+                return -1;
+            reader->buf = newbuf;
+            reader->size *= 2;
+        } else {
+            // line too long, ditch input
+            reader->used = 0;
+        }
+    }
+
+    bytes_read = read(reader->fd,
+                      reader->buf + reader->used,
+                      reader->size - reader->used);
+    if (bytes_read > 0)
+        reader->used += bytes_read;
+
+    return bytes_read;
+}
+
+static int process_input(struct dump978_reader *reader, frame_handler_v2_t handler, void *handler_data)
+{
+    char *p = reader->buf + reader->start;
     char *end = reader->buf + reader->used;
     int framecount = 0;
 
     while (p < end) {
-        char *newline;
+        struct dump978_frame frame;
+        int parsed = parse_next(&p, end, &frame, reader->frame, sizeof(reader->frame));
 
-        newline = memchr(p, '\n', end - p);
-        if (newline == NULL)
+        if (parsed < 0)
             break;
-        
-        if (*p == '-' || *p == '+')
-            framecount += process_line(reader, handler, handler_data, p, newline);
-        
-        p = newline+1;
+
+        if (parsed) {
+            handler(frame.type, frame.data, frame.len, &frame.meta, handler_data);
+            ++framecount;
+        }
     }
 
     if (p >= end) {
-        reader->used = 0;
+        reader->start = reader->used = 0;
     } else {
-        reader->used = end - p;
-        memmove(reader->buf, p, reader->used);
+        reader->start = p - reader->buf;
     }
 
     return framecount;
 }
 
-static int process_line(struct dump978_reader *reader, frame_handler_t handler, void *handler_data, char *p, char *end)
+// As process_input, but fill in up to 'max_frames' descriptors with the
+// frame data of text lines packed into the reader's arena. Each frame
+// needs at most half as many bytes as its line, so an arena of half the
+// buffer size is always enough for everything in the buffer. (Binary
+// records need no arena space.) Input is only consumed up to the last
+// frame returned; the rest is left for the next call.
+static int process_batch(struct dump978_reader *reader, struct dump978_frame *frames, int max_frames)
 {
-    uint8_t *out;
-    int len = 0;
-    frame_type_t frametype;
+    char *p = reader->buf + reader->start;
+    char *end = reader->buf + reader->used;
+    size_t arena_used = 0;
+    int framecount = 0;
+
+    if (reader->arena_size < reader->size / 2) {
+        uint8_t *newarena = realloc(reader->arena, reader->size / 2);
+        if (!newarena)
+            return -1;
+        reader->arena = newarena;
+        reader->arena_size = reader->size / 2;
+    }
+
+    while (p < end && framecount < max_frames) {
+        uint8_t *data = reader->arena + arena_used;
+        int parsed = parse_next(&p, end, &frames[framecount], data, reader->arena_size - arena_used);
+
+        if (parsed < 0)
+            break;
+
+        if (parsed) {
+            if (frames[framecount].data == data)
+                arena_used += frames[framecount].len;
+            ++framecount;
+        }
+    }
+
+    if (p >= end) {
+        reader->start = reader->used = 0;
+    } else {
+        reader->start = p - reader->buf;
+    }
+
+    return framecount;
+}
+
+// Parse the text line or binary record at *pp, up to 'end'. Returns 1
+// if a frame was parsed into 'frame' (as for parse_line), 0 if the input
+// was not a frame, or -1 if more input is needed. On 0 or 1, *pp is
+// advanced past the line or record (or, for a bad record header, past
+// the first byte only).
+static int parse_next(char **pp, char *end, struct dump978_frame *frame, uint8_t *data, size_t max_len)
+{
+    char *p = *pp;
+    char *newline, *magic;
+
+    if ((uint8_t) *p == RECORD_MAGIC) {
+        int len, type;
+
+        if (end - p < RECORD_HEADER_BYTES)
+            return -1;
+
+        type = p[1];
+        len = (uint8_t) p[2] | (uint8_t) p[3] << 8;
+        if ((type == '-' && (len == SHORT_FRAME_DATA_BYTES || len == LONG_FRAME_DATA_BYTES)) ||
+            (type == '+' && len == UPLINK_FRAME_DATA_BYTES)) {
+            if (end - p < RECORD_HEADER_BYTES + len)
+                return -1;
+
+            *pp = p + RECORD_HEADER_BYTES + len;
+            return parse_record(p, frame);
+        }
+
+        // Not a valid header. Skipping to the next newline could land
+        // inside a following record's data, so skip just this byte and
+        // look for the next record or line from there.
+        *pp = p + 1;
+        return 0;
+    }
+
+    newline = memchr(p, '\n', end - p);
+
+    // Text never contains RECORD_MAGIC. If it turns up before the
+    // newline, this is junk (perhaps left over from a bad record header)
+    // running into a record; resume at the record rather than skipping
+    // into the middle of its data. Look before any newline has arrived,
+    // too: the records that follow may not contain one.
+    magic = memchr(p + 1, RECORD_MAGIC, (newline ? newline : end) - p - 1);
+    if (magic) {
+        *pp = magic;
+        return 0;
+    }
+
+    if (newline == NULL)
+        return -1;
+
+    *pp = newline + 1;
+    if (*p == '-' || *p == '+')
+        return parse_line(p, newline, frame, data, max_len);
+
+    return 0;
+}
+
+// Parse the binary record at 'p', with its header and frame data already
+// checked to be complete. The frame data is used where it lies.
+static int parse_record(char *p, struct dump978_frame *frame)
+{
+    const uint8_t *header = (const uint8_t *) p;
+    int16_t ss, snr;
+    int i;
+
+    frame->type = (header[1] == '+' ? UAT_UPLINK : UAT_DOWNLINK);
+    frame->len = header[2] | header[3] << 8;
+    frame->data = (uint8_t *) p + RECORD_HEADER_BYTES;
+
+    memset(&frame->meta, 0, sizeof(frame->meta));
+
+    frame->meta.has_sample_offset = 1;
+    for (i = 7; i >= 0; --i)
+        frame->meta.sample_offset = (frame->meta.sample_offset << 8) | header[4+i];
+
+    ss = (int16_t) (header[12] | header[13] << 8);
+    frame->meta.has_signal_strength = 1;
+    frame->meta.signal_strength = ss / 100.0f;
+
+    snr = (int16_t) (header[14] | header[15] << 8);
+    if (snr != RECORD_SNR_UNKNOWN) {
+        frame->meta.has_snr = 1;
+        frame->meta.snr = snr / 10.0f;
+    }
+
+    frame->meta.has_rs_errors = 1;
+    frame->meta.rs_errors = header[16];
+    return 1;
+}
+
+// Parse one "-hex;metadata" or "+hex;metadata" line at 'p'..'end' into
+// 'frame', decoding the hex to 'data' (which has room for 'max_len'
+// bytes). Returns 1, or 0 if the line is not a valid frame.
+static int parse_line(char *p, char *end, struct dump978_frame *frame, uint8_t *data, size_t max_len)
+{
+    char *semicolon;
+    int len;
     
     if (*p == '-')
-        frametype = UAT_DOWNLINK;
+        frame->type = UAT_DOWNLINK;
     else if (*p == '+')
-        frametype = UAT_UPLINK;
+        frame->type = UAT_UPLINK;
     else
         return 0;
     
-    out = reader->frame;
     ++p;
+
+    // The hex data runs up to the first semicolon; the rest of the line
+    // is "extra info", like timestamp, RSSI, etc.
+    semicolon = memchr(p, ';', end - p);
+    if (!semicolon)
+        return 0; // ran off the end without seeing semicolon
+
+    if ((semicolon - p) % 2)
+        return 0; // badly formatted byte
+
+    len = (semicolon - p) / 2;
+    if (len > UPLINK_FRAME_DATA_BYTES || len > max_len)
+        return 0; // oversized frame
+
+    if (hex_decode(p, data, len) < 0)
+        return 0; // badly formatted byte
+
+    frame->data = data;
+    frame->len = len;
+    parse_metadata(semicolon + 1, end, &frame->meta);
+    return 1;
+}    
+
+// Parse a decimal number, with optional sign and fraction, that makes up
+// all of 'p'..'end'. Returns 0, or -1 if it is not such a number.
+static int parse_number(const char *p, const char *end, double *result)
+{
+    double value = 0, scale = 1;
+    int negative = 0, digits = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+        value = value * 10 + (*p - '0');
+
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+            scale /= 10;
+            value += (*p - '0') * scale;
+        }
+    }
+
+    if (p != end || !digits)
+        return -1;
+
+    *result = (negative ? -value : value);
+    return 0;
+}
+
+// Tokenize the "key=value;key=value;..." trailer in one pass over
+// 'p'..'end', filling in 'meta'. Fields without an '=' are ignored, as
+// are known keys whose value is not a number.
+static void parse_metadata(const char *p, const char *end, struct dump978_metadata *meta)
+{
+    memset(meta, 0, sizeof(*meta));
+
     while (p < end) {
-        int byte;
-
-        /*
-         * If we hit a semicolon, the rest of the line is "extra info", like timestmap, RSSI, etc.
-         * Try to parse some of it...
-         */
-        if (p[0] == ';') {
-            int done = 0;
-            float signal_strength = 0;
-            p++;
-
-            while (*p && !done) {
-                if (!strncmp(p, "ss=", 3))
-                    sscanf(p, "ss=%f;", &signal_strength);
-                if (!strncmp(p, "rssi=", 5))
-                    sscanf(p, "rssi=%f;", &signal_strength);
-                // if (!strncmp(p, "t=", 2))
-                //     sscanf(p, "t=%f;", &timestamp);
-               /* Advance until next semicolon (or end)... */
-               while (*p && *p != ';') { p++; }
-
-               // Short-circuit and bail if we have SS - remove later if we want to parse other info
-               if (!*p || (signal_strength != 0)) {
-                       done = 1;
-               } else {
-                       p++;
-               }
+        const char *key = p, *equals = NULL, *value;
+        int key_len;
+        double number;
+
+        for (; p < end && *p != ';'; ++p)
+            if (*p == '=' && !equals)
+                equals = p;
+
+        // p is now at the end of the field
+        if (!equals) {
+            ++p;
+            continue;
+        }
+
+        key_len = equals - key;
+        value = equals + 1;
+
+        if (key_len == 1 && key[0] == 't') {
+            if (parse_number(value, p, &number) == 0) {
+                meta->has_timestamp = 1;
+                meta->timestamp = number;
+            }
+        } else if (key_len == 2 && !memcmp(key, "rs", 2)) {
+            if (parse_number(value, p, &number) == 0) {
+                meta->has_rs_errors = 1;
+                meta->rs_errors = (int) number;
             }
+        } else if ((key_len == 2 && !memcmp(key, "ss", 2)) || (key_len == 4 && !memcmp(key, "rssi", 4))) {
+            if (parse_number(value, p, &number) == 0) {
+                meta->has_signal_strength = 1;
+                meta->signal_strength = (float) number;
+            }
+        } else if (key_len == 3 && !memcmp(key, "snr", 3)) {
+            if (parse_number(value, p, &number) == 0) {
+                meta->has_snr = 1;
+                meta->snr = (float) number;
+            }
+        } else if (meta->n_other < DUMP978_METADATA_MAX_OTHER) {
+            meta->other[meta->n_other].key.p = key;
+            meta->other[meta->n_other].key.len = key_len;
+            meta->other[meta->n_other].value.p = value;
+            meta->other[meta->n_other].value.len = p - value;
+            ++meta->n_other;
+        }
+
+        ++p;
+    }
+}
+
+// Convert 'len' bytes of hex at 'hex' to binary at 'out'. Returns 0, or
+// -1 if there is a character that is not a hex digit.
+//
+// The vector versions convert 16 bytes (32 digits) per step: each
+// character is checked for being a digit or (case-folded) a letter a-f,
+// converted to its value, and adjacent values combined into a byte.
+static int hex_decode(const char *hex, uint8_t *out, int len)
+{
+    int i = 0;
 
-            // ignore rest of line
-            handler(frametype, reader->frame, len, handler_data, signal_strength);
-            return 1;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_set1_epi8('0'), nine = _mm_set1_epi8(9);
+    const __m128i case_bit = _mm_set1_epi8(0x20), a = _mm_set1_epi8('a');
+    const __m128i five = _mm_set1_epi8(5), ten = _mm_set1_epi8(10);
+    const __m128i low_byte = _mm_set1_epi16(0x00FF);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i half[2];
+        int h;
+
+        for (h = 0; h < 2; ++h) {
+            __m128i c = _mm_loadu_si128((const __m128i *) (hex + i * 2 + h * 16));
+            __m128i digit = _mm_sub_epi8(c, zero);
+            __m128i letter = _mm_sub_epi8(_mm_or_si128(c, case_bit), a);
+            // unsigned x <= n  <=>  min(x, n) == x
+            __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, nine), digit);
+            __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, five), letter);
+            __m128i value;
+
+            if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xFFFF)
+                return -1;
+
+            value = _mm_or_si128(_mm_and_si128(is_digit, digit),
+                                 _mm_and_si128(is_letter, _mm_add_epi8(letter, ten)));
+
+            // each 16-bit lane holds the high digit's value in its low
+            // byte and the low digit's value in its high byte
+            half[h] = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(value, 4), _mm_srli_epi16(value, 8)), low_byte);
         }
-        
-        if (len >= sizeof(reader->frame))
-            return 0; // oversized frame
-                
-        byte = hexbyte(p);
+
+        _mm_storeu_si128((__m128i *) (out + i), _mm_packus_epi16(half[0], half[1]));
+    }
+#elif defined(__aarch64__)
+    const uint8x16_t zero = vdupq_n_u8('0'), nine = vdupq_n_u8(9);
+    const uint8x16_t case_bit = vdupq_n_u8(0x20), a = vdupq_n_u8('a');
+    const uint8x16_t five = vdupq_n_u8(5), ten = vdupq_n_u8(10);
+
+    for (; i + 16 <= len; i += 16) {
+        // val[0]: the high digits, val[1]: the low digits
+        uint8x16x2_t c = vld2q_u8((const uint8_t *) hex + i * 2);
+        uint8x16_t value[2];
+        int h;
+
+        for (h = 0; h < 2; ++h) {
+            uint8x16_t digit = vsubq_u8(c.val[h], zero);
+            uint8x16_t letter = vsubq_u8(vorrq_u8(c.val[h], case_bit), a);
+            uint8x16_t is_digit = vcleq_u8(digit, nine);
+            uint8x16_t is_letter = vcleq_u8(letter, five);
+
+            if (vminvq_u8(vorrq_u8(is_digit, is_letter)) != 0xFF)
+                return -1;
+
+            value[h] = vbslq_u8(is_digit, digit, vaddq_u8(letter, ten));
+        }
+
+        vst1q_u8(out + i, vorrq_u8(vshlq_n_u8(value[0], 4), value[1]));
+    }
+#endif
+
+    for (; i < len; ++i) {
+        int byte = hexbyte(hex + i * 2);
         if (byte < 0)
-            return 0; // badly formatted byte
-                
-        ++len;
-        *out++ = byte;
-        p += 2;
+            return -1;
+        out[i] = byte;
     }
 
-    return 0; // ran off the end without seeing semicolon
-}    
+    return 0;
+}
 
-static int hexbyte(char *buf)
+static int hexbyte(const char *buf)
 {
     int i;
     char c;
@@ -36,6 +36,56 @@ typedef enum { UAT_UPLINK, UAT_DOWNLINK } frame_type_t;
 // preserve the data after returning, it should take a copy.
 typedef void (*frame_handler_t)(frame_type_t t,uint8_t *f,int l,void *d, float ss);
 
+// Most unknown metadata keys passed to a v2 handler; further ones are dropped
+#define DUMP978_METADATA_MAX_OTHER 8
+
+// A slice of the input line; not NUL-terminated
+struct dump978_slice {
+    const char *p;
+    int len;
+};
+
+// Metadata from the ";key=value;key=value;..." trailer of a frame line,
+// or from the header of a binary record, for dump978_read_frames_v2.
+// Each has_ flag says whether the value was present (and, in text,
+// parsed as a number).
+struct dump978_metadata {
+    int has_timestamp;
+    double timestamp;        // t=
+    int has_rs_errors;
+    int rs_errors;           // rs=
+    int has_signal_strength;
+    float signal_strength;   // ss= or rssi=, dBFS
+    int has_snr;
+    float snr;               // snr=, dB
+    int has_sample_offset;
+    uint64_t sample_offset;  // binary records only
+
+    // any other keys in a text line, in order of appearance; the slices
+    // point into the reader's buffer and are only valid during the
+    // handler call
+    int n_other;
+    struct {
+        struct dump978_slice key;
+        struct dump978_slice value;
+    } other[DUMP978_METADATA_MAX_OTHER];
+};
+
+// Function pointer type for a handler called by dump978_read_frames_v2().
+// As frame_handler_t, but with all of the line's metadata in 'm'. 'm' is
+// owned by the caller and only valid until the handler returns.
+typedef void (*frame_handler_v2_t)(frame_type_t t, uint8_t *f, int l, const struct dump978_metadata *m, void *d);
+
+// A frame returned by dump978_read_frame_batch(). 'data' points into an
+// arena owned by the reader, and the metadata slices into its input
+// buffer; both stay valid until the next call on the same reader.
+struct dump978_frame {
+    frame_type_t type;
+    uint8_t *data;
+    int len;
+    struct dump978_metadata meta;
+};
+
 // Allocate a new reader that reads from file descriptor 'fd'.
 // If 'nonblock' is nonzero, the FD will be made nonblocking.
 // Returns the reader, or NULL on error with errno set.
@@ -58,6 +108,24 @@ int dump978_read_frames(struct dump978_reader *reader,
                         frame_handler_t handler,
                         void *handler_data);
 
+// As dump978_read_frames, but call a v2 handler with the frame metadata.
+int dump978_read_frames_v2(struct dump978_reader *reader,
+                           frame_handler_v2_t handler,
+                           void *handler_data);
+
+// Read frames from a reader into 'frames', up to 'max_frames' at a time,
+// without a per-frame callback or copy. Already-buffered input is used
+// first; otherwise this reads until at least one complete frame is
+// available.
+//
+// Returns the number of frames stored (>0) on success, 0 on EOF, or -1
+// on error or if no frames are available (errno set, to EAGAIN etc for
+// a non-blocking reader). Frames not returned stay buffered for the
+// next call.
+int dump978_read_frame_batch(struct dump978_reader *reader,
+                             struct dump978_frame *frames,
+                             int max_frames);
+
 #endif
 
 
@@ -0,0 +1,674 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "uat.h"
+#include "reader.h"
+
+// Generate a stream of frames as text lines, binary records or a mix of
+// the two, along with input that must be skipped, feed it to a reader
+// through a pipe a few bytes at a time, and check that every frame comes
+// back with the right data and metadata.
+
+#define MAX_FRAMES 200
+#define MAX_INPUT (MAX_FRAMES * 2400 + 200000)
+
+// larger than the reader's initial buffer, so that it has to grow
+#define LONG_JUNK_LINE 100000
+
+struct expected {
+    frame_type_t type;
+    int len;
+    uint8_t data[UPLINK_FRAME_DATA_BYTES];
+    struct dump978_metadata meta;   // slices point into other_text
+    char other_text[64];
+};
+
+struct stream {
+    uint8_t input[MAX_INPUT];
+    size_t len;
+    struct expected frames[MAX_FRAMES];
+    int nframes;
+};
+
+enum format { FORMAT_TEXT, FORMAT_BINARY, FORMAT_MIXED };
+
+static uint32_t lcg_state = 1;
+
+static uint32_t lcg(void)
+{
+    lcg_state = lcg_state * 1103515245 + 12345;
+    return lcg_state >> 8;
+}
+
+static void append(struct stream *s, const void *data, size_t len)
+{
+    memcpy(s->input + s->len, data, len);
+    s->len += len;
+}
+
+static void append_text(struct stream *s, const struct expected *e, int variant)
+{
+    char line[1200];
+    int i, n;
+
+    n = sprintf(line, "%c", e->type == UAT_UPLINK ? '+' : '-');
+    for (i = 0; i < e->len; ++i)
+        n += sprintf(line + n, (variant & 1) ? "%02X" : "%02x", e->data[i]);
+    line[n++] = ';';
+
+    if (e->meta.has_timestamp)
+        n += sprintf(line + n, "t=%.3f;", e->meta.timestamp);
+    if (e->meta.has_rs_errors)
+        n += sprintf(line + n, "rs=%d;", e->meta.rs_errors);
+    if (e->meta.has_signal_strength)
+        n += sprintf(line + n, (variant & 2) ? "rssi=%.1f;" : "ss=%.1f;", e->meta.signal_strength);
+    if (e->meta.has_snr)
+        n += sprintf(line + n, "snr=%.1f;", e->meta.snr);
+    if (e->meta.n_other)
+        n += sprintf(line + n, "%s;", e->other_text);
+
+    line[n++] = '\n';
+    append(s, line, n);
+}
+
+// A line that looks like a frame but is malformed, and must be skipped
+static void append_bad_line(struct stream *s)
+{
+    static const char not_hex[] = "/:@G`g";
+    char line[1200];
+    int i, n, len = 1 + lcg() % LONG_FRAME_DATA_BYTES;
+
+    n = sprintf(line, "-");
+    for (i = 0; i < len; ++i)
+        n += sprintf(line + n, "%02x", (uint8_t) lcg());
+
+    switch (lcg() % 4) {
+    case 0:
+        // odd number of hex digits
+        line[--n] = 0;
+        break;
+    case 1:
+        // not a hex digit, anywhere in the run, so that both the vector
+        // and the scalar conversion see one
+        line[1 + lcg() % (n - 1)] = not_hex[lcg() % (sizeof(not_hex) - 1)];
+        break;
+    case 2:
+        // longer than any frame
+        for (i = len; i <= UPLINK_FRAME_DATA_BYTES; ++i)
+            n += sprintf(line + n, "00");
+        break;
+    case 3:
+        // no ';' after the data
+        line[n++] = '\n';
+        append(s, line, n);
+        return;
+    }
+
+    n += sprintf(line + n, ";ss=-1.0;\n");
+    append(s, line, n);
+}
+
+static void put_le(uint8_t *p, uint64_t value, int bytes)
+{
+    int i;
+    for (i = 0; i < bytes; ++i)
+        p[i] = (uint8_t) (value >> (8 * i));
+}
+
+static void append_record(struct stream *s, const struct expected *e)
+{
+    uint8_t header[RECORD_HEADER_BYTES];
+
+    header[0] = RECORD_MAGIC;
+    header[1] = (e->type == UAT_UPLINK ? '+' : '-');
+    put_le(header + 2, e->len, 2);
+    put_le(header + 4, e->meta.sample_offset, 8);
+    put_le(header + 12, (uint16_t) (int16_t) lrintf(e->meta.signal_strength * 100), 2);
+    put_le(header + 14, (uint16_t) (e->meta.has_snr ? (int16_t) lrintf(e->meta.snr * 10) : RECORD_SNR_UNKNOWN), 2);
+    header[16] = (uint8_t) e->meta.rs_errors;
+
+    append(s, header, sizeof(header));
+    append(s, e->data, e->len);
+}
+
+// Junk that a reader must skip without losing its place in a stream of
+// records: a magic byte whose header has a bad length for its type, or a
+// partial text line cut off by the start of a record. Neither contains
+// a newline, so skipping to the next newline would land inside a record.
+static void append_bad_record(struct stream *s)
+{
+    static const uint8_t bad_header[RECORD_HEADER_BYTES] = {
+        RECORD_MAGIC, '-', 0x23, 0x00, 'j', 'u', 'n', 'k'
+    };
+
+    if (lcg() & 1)
+        append(s, bad_header, sizeof(bad_header));
+    else
+        append(s, "-0011223344", 11);
+}
+
+static void make_stream(struct stream *s, enum format format, int nframes)
+{
+    static const int lengths[3] = { SHORT_FRAME_DATA_BYTES, LONG_FRAME_DATA_BYTES, UPLINK_FRAME_DATA_BYTES };
+    int i, j;
+
+    s->len = 0;
+    s->nframes = nframes;
+
+    // lines that are not frames are skipped
+    append(s, "# not a frame\n", 14);
+
+    for (i = 0; i < nframes; ++i) {
+        struct expected *e = &s->frames[i];
+        int binary = (format == FORMAT_BINARY || (format == FORMAT_MIXED && (lcg() & 1)));
+        int variant = lcg();
+
+        memset(e, 0, sizeof(*e));
+        e->len = lengths[lcg() % 3];
+        e->type = (e->len == UPLINK_FRAME_DATA_BYTES ? UAT_UPLINK : UAT_DOWNLINK);
+        for (j = 0; j < e->len; ++j)
+            e->data[j] = (uint8_t) lcg();
+
+        if (binary) {
+            if (variant & 8)
+                append_bad_record(s);
+
+            e->meta.has_sample_offset = 1;
+            e->meta.sample_offset = ((uint64_t) lcg() << 24) ^ lcg();
+            e->meta.has_signal_strength = 1;
+            e->meta.signal_strength = -(int) (lcg() % 4000) / 100.0f;
+            e->meta.has_snr = (lcg() & 1);
+            e->meta.snr = (e->meta.has_snr ? (int) (lcg() % 400) / 10.0f : 0);
+            e->meta.has_rs_errors = 1;
+            e->meta.rs_errors = lcg() % 11;
+            append_record(s, e);
+        } else {
+            if (variant & 8)
+                append_bad_line(s);
+
+            // without any metadata the line ends in a bare ';', which
+            // must not pick up the next line's values
+            e->meta.has_timestamp = (variant & 4) != 0;
+            e->meta.timestamp = (e->meta.has_timestamp ? 1400000000 + (lcg() % 1000000) / 1000.0 : 0);
+            e->meta.has_rs_errors = (variant & 32) != 0;
+            e->meta.rs_errors = (e->meta.has_rs_errors ? lcg() % 11 : 0);
+            e->meta.has_signal_strength = (variant & 16) != 0;
+            e->meta.signal_strength = (e->meta.has_signal_strength ? -(int) (1 + lcg() % 400) / 10.0f : 0);
+            e->meta.has_snr = (variant & 128) != 0;
+            e->meta.snr = (e->meta.has_snr ? (int) (lcg() % 400) / 10.0f : 0);
+            if (variant & 64) {
+                int n = sprintf(e->other_text, "station=%u", lcg() % 1000);
+                e->meta.n_other = 1;
+                e->meta.other[0].key.p = e->other_text;
+                e->meta.other[0].key.len = 7;
+                e->meta.other[0].value.p = e->other_text + 8;
+                e->meta.other[0].value.len = n - 8;
+            }
+            append_text(s, e, variant);
+        }
+
+        if (i == nframes / 2) {
+            // a junk line longer than the reader's initial buffer
+            for (j = 0; j < LONG_JUNK_LINE; ++j)
+                s->input[s->len + j] = (j ? 'x' : '#');
+            s->len += LONG_JUNK_LINE;
+            append(s, "\n", 1);
+        }
+    }
+}
+
+static int slice_equals(struct dump978_slice slice, const char *p, int len)
+{
+    return slice.len == len && !memcmp(slice.p, p, len);
+}
+
+// Check one frame's data against what was expected; returns 1 if it matches
+static int check_data(const struct expected *e, frame_type_t type, const uint8_t *data, int len)
+{
+    if (type != e->type || len != e->len || memcmp(data, e->data, len) != 0) {
+        fprintf(stderr, "  wrong frame type, length or data\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+// Check one frame's metadata against what was expected; returns 1 if it
+// matches
+static int check_metadata(const struct expected *e, const struct dump978_metadata *m)
+{
+    int i;
+
+    if (m->has_timestamp != e->meta.has_timestamp ||
+        (m->has_timestamp && fabs(m->timestamp - e->meta.timestamp) > 1e-6) ||
+        m->has_rs_errors != e->meta.has_rs_errors || m->rs_errors != e->meta.rs_errors ||
+        m->has_signal_strength != e->meta.has_signal_strength ||
+        (m->has_signal_strength && fabsf(m->signal_strength - e->meta.signal_strength) > 1e-4) ||
+        m->has_snr != e->meta.has_snr ||
+        (m->has_snr && fabsf(m->snr - e->meta.snr) > 1e-4) ||
+        m->has_sample_offset != e->meta.has_sample_offset || m->sample_offset != e->meta.sample_offset) {
+        fprintf(stderr, "  wrong metadata\n");
+        return 0;
+    }
+
+    if (m->n_other != e->meta.n_other) {
+        fprintf(stderr, "  expected %d other metadata keys, got %d\n", e->meta.n_other, m->n_other);
+        return 0;
+    }
+
+    for (i = 0; i < m->n_other; ++i) {
+        if (!slice_equals(m->other[i].key, e->meta.other[i].key.p, e->meta.other[i].key.len) ||
+            !slice_equals(m->other[i].value, e->meta.other[i].value.p, e->meta.other[i].value.len)) {
+            fprintf(stderr, "  wrong other metadata key %d\n", i);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+struct check_state {
+    const struct stream *stream;
+    int seen;
+    int ok;
+};
+
+// Returns the next expected frame, or NULL if there should be no more
+static const struct expected *next_expected(struct check_state *state)
+{
+    if (!state->ok)
+        return NULL;
+
+    if (state->seen >= state->stream->nframes) {
+        fprintf(stderr, "  too many frames\n");
+        state->ok = 0;
+        return NULL;
+    }
+
+    return &state->stream->frames[state->seen++];
+}
+
+static void check_handler(frame_type_t t, uint8_t *f, int l, void *d, float ss)
+{
+    struct check_state *state = d;
+    const struct expected *e = next_expected(state);
+
+    if (!e)
+        return;
+
+    // the v1 handler sees only the signal strength, or 0 without one
+    if (!check_data(e, t, f, l) || fabsf(ss - e->meta.signal_strength) > 1e-4) {
+        fprintf(stderr, "  (frame %d)\n", state->seen - 1);
+        state->ok = 0;
+    }
+}
+
+static void check_v2_handler(frame_type_t t, uint8_t *f, int l, const struct dump978_metadata *m, void *d)
+{
+    struct check_state *state = d;
+    const struct expected *e = next_expected(state);
+
+    if (!e)
+        return;
+
+    if (!check_data(e, t, f, l) || !check_metadata(e, m)) {
+        fprintf(stderr, "  (frame %d)\n", state->seen - 1);
+        state->ok = 0;
+    }
+}
+
+static int write_all(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0)
+            return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Feed 'stream' to a non-blocking reader 'chunk' bytes at a time, reading
+// everything available after each write with dump978_read_frames, or
+// dump978_read_frames_v2 if 'v2' is set
+static int test_read(const struct stream *stream, size_t chunk, int v2)
+{
+    struct check_state state = { stream, 0, 1 };
+    struct dump978_reader *reader;
+    size_t pos = 0;
+    int fds[2], n;
+
+    if (pipe(fds) < 0 || !(reader = dump978_reader_new(fds[0], 1))) {
+        perror("  setup");
+        return 0;
+    }
+
+    for (;;) {
+        if (pos < stream->len) {
+            size_t len = (stream->len - pos < chunk ? stream->len - pos : chunk);
+            if (write_all(fds[1], stream->input + pos, len) < 0) {
+                perror("  write");
+                state.ok = 0;
+                break;
+            }
+            pos += len;
+            if (pos == stream->len)
+                close(fds[1]);
+        }
+
+        do {
+            if (v2)
+                n = dump978_read_frames_v2(reader, check_v2_handler, &state);
+            else
+                n = dump978_read_frames(reader, check_handler, &state);
+        } while (n > 0);
+
+        if (n == 0)
+            break; // EOF
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror(v2 ? "  dump978_read_frames_v2" : "  dump978_read_frames");
+            state.ok = 0;
+            break;
+        }
+    }
+
+    if (pos < stream->len)
+        close(fds[1]);
+    close(fds[0]);
+    dump978_reader_free(reader);
+
+    if (state.ok && state.seen != stream->nframes) {
+        fprintf(stderr, "  expected %d frames, got %d\n", stream->nframes, state.seen);
+        state.ok = 0;
+    }
+
+    return state.ok;
+}
+
+// As test_read, but read with dump978_read_frame_batch, up to 'max_frames'
+// at a time. Each batch is checked only after the call returns, so frames
+// that share arena space would show up.
+static int test_batch(const struct stream *stream, size_t chunk, int max_frames)
+{
+    struct dump978_frame frames[64];
+    struct dump978_reader *reader;
+    size_t pos = 0;
+    int fds[2], n, i, seen = 0, ok = 1;
+
+    if (pipe(fds) < 0 || !(reader = dump978_reader_new(fds[0], 1))) {
+        perror("  setup");
+        return 0;
+    }
+
+    while (ok) {
+        if (pos < stream->len) {
+            size_t len = (stream->len - pos < chunk ? stream->len - pos : chunk);
+            if (write_all(fds[1], stream->input + pos, len) < 0) {
+                perror("  write");
+                ok = 0;
+                break;
+            }
+            pos += len;
+            if (pos == stream->len)
+                close(fds[1]);
+        }
+
+        while (ok && (n = dump978_read_frame_batch(reader, frames, max_frames)) > 0) {
+            if (n > max_frames || seen + n > stream->nframes) {
+                fprintf(stderr, "  too many frames\n");
+                ok = 0;
+                break;
+            }
+
+            for (i = 0; i < n && ok; ++i, ++seen) {
+                const struct expected *e = &stream->frames[seen];
+                if (!check_data(e, frames[i].type, frames[i].data, frames[i].len) ||
+                    !check_metadata(e, &frames[i].meta)) {
+                    fprintf(stderr, "  (frame %d)\n", seen);
+                    ok = 0;
+                }
+            }
+        }
+
+        if (!ok || n == 0)
+            break; // failed, or EOF
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror("  dump978_read_frame_batch");
+            ok = 0;
+        }
+    }
+
+    if (pos < stream->len)
+        close(fds[1]);
+    close(fds[0]);
+    dump978_reader_free(reader);
+
+    if (ok && seen != stream->nframes) {
+        fprintf(stderr, "  expected %d frames, got %d\n", stream->nframes, seen);
+        ok = 0;
+    }
+
+    return ok;
+}
+
+// Metadata trailers that the stream test doesn't generate, one per line
+static const char metadata_input[] =
+    // non-numeric values for known keys, fields without '=', signs
+    "-0011223344556677889900112233445566778899;t=soon;rs=;junk;ss=+1.5;snr=-2;=empty;\n"
+    // more unknown keys than fit: the first few are kept, in order
+    "-0011223344556677889900112233445566778899;a=1;b=2;c=3;d=4;e=5;f=6;g=7;h=8;i=9;j=10;rs=2\n"
+    // no trailer at all
+    "-0011223344556677889900112233445566778899;\n";
+
+static int check_metadata_line(int line, const struct dump978_metadata *m)
+{
+    int i;
+
+    switch (line) {
+    case 0:
+        if (m->has_timestamp || m->has_rs_errors ||
+            !m->has_signal_strength || m->signal_strength != 1.5f ||
+            !m->has_snr || m->snr != -2.0f ||
+            m->n_other != 1 || !slice_equals(m->other[0].key, "", 0) ||
+            !slice_equals(m->other[0].value, "empty", 5)) {
+            fprintf(stderr, "  line 1: wrong metadata\n");
+            return 0;
+        }
+        return 1;
+
+    case 1:
+        if (m->n_other != DUMP978_METADATA_MAX_OTHER || !m->has_rs_errors || m->rs_errors != 2) {
+            fprintf(stderr, "  line 2: wrong metadata\n");
+            return 0;
+        }
+        for (i = 0; i < DUMP978_METADATA_MAX_OTHER; ++i) {
+            char key = 'a' + i, value = '1' + i;
+            if (!slice_equals(m->other[i].key, &key, 1) || !slice_equals(m->other[i].value, &value, 1)) {
+                fprintf(stderr, "  line 2: wrong other metadata key %d\n", i);
+                return 0;
+            }
+        }
+        return 1;
+
+    case 2:
+        if (m->has_timestamp || m->has_rs_errors || m->has_signal_strength ||
+            m->has_snr || m->has_sample_offset || m->n_other != 0) {
+            fprintf(stderr, "  line 3: unexpected metadata\n");
+            return 0;
+        }
+        return 1;
+
+    default:
+        fprintf(stderr, "  too many frames\n");
+        return 0;
+    }
+}
+
+static void metadata_handler(frame_type_t t, uint8_t *f, int l, const struct dump978_metadata *m, void *d)
+{
+    struct check_state *state = d;
+
+    if (!check_metadata_line(state->seen++, m))
+        state->ok = 0;
+}
+
+static int test_metadata(void)
+{
+    struct check_state state = { NULL, 0, 1 };
+    struct dump978_reader *reader;
+    int fds[2], n;
+
+    if (pipe(fds) < 0 || !(reader = dump978_reader_new(fds[0], 0))) {
+        perror("  setup");
+        return 0;
+    }
+
+    if (write_all(fds[1], (const uint8_t *) metadata_input, sizeof(metadata_input) - 1) < 0) {
+        perror("  write");
+        return 0;
+    }
+    close(fds[1]);
+
+    while ((n = dump978_read_frames_v2(reader, metadata_handler, &state)) > 0)
+        ;
+
+    if (n < 0) {
+        perror("  dump978_read_frames_v2");
+        state.ok = 0;
+    } else if (state.seen != 3) {
+        fprintf(stderr, "  expected 3 frames, got %d\n", state.seen);
+        state.ok = 0;
+    }
+
+    close(fds[0]);
+    dump978_reader_free(reader);
+    return state.ok;
+}
+
+// A bad record header, then a partial text line, each followed by a
+// record, with no newline anywhere: both records must be found without
+// waiting for a newline that never comes
+static int test_resync(void)
+{
+    static const uint8_t bad_header[RECORD_HEADER_BYTES] = { RECORD_MAGIC, '+', 0x10, 0x00 };
+    static struct stream s;
+    struct dump978_frame frames[4];
+    struct dump978_reader *reader;
+    int fds[2], n, i, ok = 1;
+
+    s.len = 0;
+    s.nframes = 2;
+    for (i = 0; i < s.nframes; ++i) {
+        struct expected *e = &s.frames[i];
+
+        memset(e, 0, sizeof(*e));
+        e->type = UAT_DOWNLINK;
+        e->len = LONG_FRAME_DATA_BYTES;
+        memset(e->data, 0x55, e->len);
+        e->meta.has_sample_offset = e->meta.has_signal_strength = e->meta.has_rs_errors = 1;
+        e->meta.sample_offset = 1000 * (i + 1);
+
+        if (i == 0)
+            append(&s, bad_header, sizeof(bad_header));
+        else
+            append(&s, "-0011223344", 11);
+        append_record(&s, e);
+    }
+
+    if (pipe(fds) < 0 || !(reader = dump978_reader_new(fds[0], 0))) {
+        perror("  setup");
+        return 0;
+    }
+
+    if (write_all(fds[1], s.input, s.len) < 0) {
+        perror("  write");
+        return 0;
+    }
+    close(fds[1]);
+
+    for (i = 0; ok && (n = dump978_read_frame_batch(reader, frames, 4)) > 0; ) {
+        int j;
+        for (j = 0; j < n && ok; ++j, ++i) {
+            if (i >= s.nframes) {
+                fprintf(stderr, "  too many frames\n");
+                ok = 0;
+            } else if (!check_data(&s.frames[i], frames[j].type, frames[j].data, frames[j].len) ||
+                       !check_metadata(&s.frames[i], &frames[j].meta)) {
+                fprintf(stderr, "  (frame %d)\n", i);
+                ok = 0;
+            }
+        }
+    }
+
+    if (ok && i != s.nframes) {
+        fprintf(stderr, "  expected %d frames, got %d\n", s.nframes, i);
+        ok = 0;
+    }
+
+    close(fds[0]);
+    dump978_reader_free(reader);
+    return ok;
+}
+
+static int report(const char *name, int ok)
+{
+    fprintf(stderr, "%s: %s\n", name, ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *const format_names[3] = { "text", "binary", "mixed" };
+    static const size_t chunks[] = { 1, 7, 100, 4096, 32768 };
+    static const int batch_sizes[] = { 1, 3, 64 };
+    static struct stream stream;
+    char name[128];
+    int format, c, m;
+    int all_ok = 1;
+
+    for (format = FORMAT_TEXT; format <= FORMAT_MIXED; ++format) {
+        make_stream(&stream, format, MAX_FRAMES);
+
+        for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c) {
+            snprintf(name, sizeof(name), "%s, %zu byte writes, read_frames", format_names[format], chunks[c]);
+            all_ok &= report(name, test_read(&stream, chunks[c], 0));
+
+            snprintf(name, sizeof(name), "%s, %zu byte writes, read_frames_v2", format_names[format], chunks[c]);
+            all_ok &= report(name, test_read(&stream, chunks[c], 1));
+
+            for (m = 0; m < sizeof(batch_sizes) / sizeof(batch_sizes[0]); ++m) {
+                snprintf(name, sizeof(name), "%s, %zu byte writes, batches of %d",
+                         format_names[format], chunks[c], batch_sizes[m]);
+                all_ok &= report(name, test_batch(&stream, chunks[c], batch_sizes[m]));
+            }
+        }
+    }
+
+    all_ok &= report("metadata", test_metadata());
+    all_ok &= report("resync without newlines", test_resync());
+
+    return all_ok ? 0 : 1;
+}
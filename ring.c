@@ -0,0 +1,292 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "ring.h"
+
+static void waiter_init(struct waiter *w)
+{
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    atomic_init(&w->epoch, 0);
+    atomic_init(&w->sleepers, 0);
+}
+
+static void waiter_destroy(struct waiter *w)
+{
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+}
+
+// Wake everyone sleeping on 'w'. The caller must have published whatever
+// the sleepers are waiting for before calling this.
+static void waiter_wake(struct waiter *w)
+{
+    atomic_fetch_add(&w->epoch, 1);
+    if (atomic_load(&w->sleepers)) {
+        pthread_mutex_lock(&w->lock);
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+    }
+}
+
+// Sleeping is a two-step process so that a wakeup between checking the
+// condition and going to sleep is not lost:
+//
+//   epoch = waiter_prepare(w);
+//   if (!condition) waiter_sleep(w, epoch);
+//   waiter_done(w);
+//
+// waiter_wake() bumps the epoch after publishing, so either the condition
+// check sees the new state, or the epoch has changed and waiter_sleep()
+// returns immediately (or is woken by the broadcast).
+static unsigned waiter_prepare(struct waiter *w)
+{
+    atomic_fetch_add(&w->sleepers, 1);
+    return atomic_load(&w->epoch);
+}
+
+static void waiter_sleep(struct waiter *w, unsigned epoch)
+{
+    pthread_mutex_lock(&w->lock);
+    while (atomic_load(&w->epoch) == epoch)
+        pthread_cond_wait(&w->cond, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+static void waiter_done(struct waiter *w)
+{
+    atomic_fetch_sub(&w->sleepers, 1);
+}
+
+// Return an unlinked file descriptor for 'size' bytes of shared memory
+static int mirror_fd(size_t size)
+{
+    int fd = -1;
+
+#ifdef MFD_CLOEXEC
+    fd = memfd_create("dump978-ring", MFD_CLOEXEC);
+#endif
+    if (fd < 0) {
+        // no memfd_create (old kernel or libc): use an unlinked temp file
+        const char *dir = getenv("TMPDIR");
+        char path[4096];
+
+        snprintf(path, sizeof(path), "%s/dump978-ring-XXXXXX", dir ? dir : "/tmp");
+        if ((fd = mkstemp(path)) < 0)
+            return -1;
+        unlink(path);
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+void *mirror_alloc(size_t size)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+    uint8_t *base;
+    int fd, err;
+
+    if (size == 0 || (pagesize > 0 && size % pagesize) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if ((fd = mirror_fd(size)) < 0)
+        return NULL;
+
+    // reserve address space for both copies, then map the same pages
+    // over each half of it
+    base = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        goto fail;
+
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        err = errno;
+        munmap(base, size * 2);
+        errno = err;
+        goto fail;
+    }
+
+    close(fd);
+    return base;
+
+ fail:
+    err = errno;
+    close(fd);
+    errno = err;
+    return NULL;
+}
+
+void mirror_free(void *p, size_t size)
+{
+    if (p)
+        munmap(p, size * 2);
+}
+
+int ring_init(struct ring *ring, size_t size)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+
+    if (size == 0 || (size & (size - 1)) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (pagesize > 0 && size < (size_t) pagesize)
+        size = pagesize;
+
+    if (!(ring->buf = mirror_alloc(size)))
+        return -1;
+
+    ring->size = size;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->closed, 0);
+    waiter_init(&ring->readable);
+    waiter_init(&ring->writable);
+    return 0;
+}
+
+void ring_destroy(struct ring *ring)
+{
+    waiter_destroy(&ring->readable);
+    waiter_destroy(&ring->writable);
+    mirror_free(ring->buf, ring->size);
+    ring->buf = NULL;
+}
+
+static size_t ring_free_space(struct ring *ring)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return ring->size - (size_t)(head - tail);
+}
+
+void *ring_reserve(struct ring *ring, size_t need, size_t *avail)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t space;
+
+    while ((space = ring_free_space(ring)) < need) {
+        unsigned epoch = waiter_prepare(&ring->writable);
+        if (ring_free_space(ring) < need)
+            waiter_sleep(&ring->writable, epoch);
+        waiter_done(&ring->writable);
+    }
+
+    // all free space is contiguous thanks to the double mapping
+    *avail = space;
+    return ring_ptr(ring, head);
+}
+
+void *ring_try_reserve(struct ring *ring, size_t need, size_t *avail)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t space = ring_free_space(ring);
+
+    if (space < need)
+        return NULL;
+
+    *avail = space;
+    return ring_ptr(ring, head);
+}
+
+void ring_commit(struct ring *ring, size_t len)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->head, head + len, memory_order_release);
+    waiter_wake(&ring->readable);
+}
+
+void ring_close(struct ring *ring)
+{
+    atomic_store(&ring->closed, 1);
+    waiter_wake(&ring->readable);
+}
+
+size_t ring_wait_readable(struct ring *ring, uint64_t pos, size_t need)
+{
+    for (;;) {
+        // check 'closed' first: once it is set, head is final
+        int closed = atomic_load(&ring->closed);
+        size_t avail = atomic_load_explicit(&ring->head, memory_order_acquire) - pos;
+        unsigned epoch;
+
+        if (avail >= need || closed)
+            return avail;
+
+        epoch = waiter_prepare(&ring->readable);
+        if (!atomic_load(&ring->closed) && atomic_load(&ring->head) - pos < need)
+            waiter_sleep(&ring->readable, epoch);
+        waiter_done(&ring->readable);
+    }
+}
+
+void ring_release(struct ring *ring, uint64_t pos)
+{
+    atomic_store_explicit(&ring->tail, pos, memory_order_release);
+    waiter_wake(&ring->writable);
+}
+
+int ring_release_if(struct ring *ring, uint64_t expected, uint64_t pos)
+{
+    if (!atomic_compare_exchange_strong_explicit(&ring->tail, &expected, pos,
+                                                 memory_order_acq_rel, memory_order_acquire))
+        return 0;
+
+    waiter_wake(&ring->writable);
+    return 1;
+}
+
+void ring_push(struct ring *ring, const void *data, size_t len)
+{
+    size_t avail;
+    void *p = ring_reserve(ring, len, &avail);
+
+    memcpy(p, data, len);
+    ring_commit(ring, len);
+}
+
+int ring_pop(struct ring *ring, void *data, size_t len)
+{
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (ring_wait_readable(ring, tail, len) < len)
+        return 0;
+
+    memcpy(data, ring_ptr(ring, tail), len);
+    ring_release(ring, tail + len);
+    return 1;
+}
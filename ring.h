@@ -0,0 +1,129 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP978_RING_H
+#define DUMP978_RING_H
+
+// Single-producer byte ring.
+//
+// Positions are absolute byte counts since the ring was created and never
+// wrap; the buffer index is the position modulo the ring size. The producer
+// advances 'head' and the consumer advances 'tail', each with release
+// ordering, so no locks are taken while there is data or space.
+//
+// Normally only the consumer moves the tail, with ring_release(). A ring
+// may instead let the producer free space too, by discarding the oldest
+// unread data (writer.c does this to drop output nobody is reading). On
+// such a ring every release, by either side, must go through
+// ring_release_if(), which moves the tail only if nobody else has moved it
+// since it was read; of two racing releases from the same tail exactly one
+// succeeds. ring_release() and ring_pop() must not be used there: they
+// store the tail unconditionally and could move it back over a concurrent
+// discard.
+//
+// The buffer is mapped twice, back to back (see mirror_alloc), so any span
+// of up to 'size' bytes can be accessed contiguously from ring_ptr()
+// regardless of where it falls. This lets the demodulator look at a whole
+// frame in place, and the producer write across the wrap point, without
+// copying anything.
+//
+// Other threads may read the data between tail and head as long as the
+// consumer doesn't release it while they're doing so; the pipeline uses
+// this to let several stages share one sample buffer.
+//
+// A side that finds the ring empty (or full) sleeps on a condition
+// variable; the other side only takes the lock when someone is sleeping.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+struct waiter {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    atomic_uint epoch;      // bumped on every wakeup
+    atomic_uint sleepers;   // number of threads in (or about to enter) cond_wait
+};
+
+struct ring {
+    uint8_t *buf;
+    size_t size;            // power of two, multiple of the page size
+
+    _Alignas(64) _Atomic uint64_t head;    // written by the producer
+    _Alignas(64) _Atomic uint64_t tail;    // written by the consumer
+    atomic_int closed;                     // producer has finished
+
+    struct waiter readable;
+    struct waiter writable;
+};
+
+/* Allocate 'size' bytes of memory, a multiple of the page size, that
+ * appear twice in a row: p[i] and p[i + size] are the same byte for
+ * 0 <= i < size. Returns NULL on failure with errno set. */
+void *mirror_alloc(size_t size);
+void mirror_free(void *p, size_t size);
+
+/* Initialize a ring of at least 'size' bytes (a power of two; it is rounded
+ * up to the page size). Returns 0 on success, -1 on failure with errno set. */
+int ring_init(struct ring *ring, size_t size);
+void ring_destroy(struct ring *ring);
+
+/* Producer: wait until at least 'need' bytes are free, and return a pointer
+ * to the head. '*avail' is set to the number of bytes that may be written
+ * there contiguously (at least 'need', which must not exceed the ring
+ * size). */
+void *ring_reserve(struct ring *ring, size_t need, size_t *avail);
+
+/* Producer: as ring_reserve(), but return NULL instead of waiting if
+ * fewer than 'need' bytes are free */
+void *ring_try_reserve(struct ring *ring, size_t need, size_t *avail);
+
+/* Producer: publish 'len' bytes written at the pointer from ring_reserve() */
+void ring_commit(struct ring *ring, size_t len);
+
+/* Producer: mark the end of the data and wake any waiting reader */
+void ring_close(struct ring *ring);
+
+/* Reader: wait until at least 'need' bytes past 'pos' are readable, or the
+ * ring is closed. Returns the number of bytes readable from 'pos', which is
+ * less than 'need' only if the ring is closed. */
+size_t ring_wait_readable(struct ring *ring, uint64_t pos, size_t need);
+
+/* Consumer: free everything before 'pos'. Only for rings where the
+ * consumer is the only one to free space. */
+void ring_release(struct ring *ring, uint64_t pos);
+
+/* Producer or consumer: free everything before 'pos' only if the tail is
+ * still at 'expected'; returns 1 if it was, 0 otherwise. On rings where
+ * the producer may discard unread data (see above), a reader must not use
+ * anything it read from the ring unless its release succeeds, since a
+ * failed release means the producer may already be overwriting it. */
+int ring_release_if(struct ring *ring, uint64_t expected, uint64_t pos);
+
+/* Copy a 'len' byte record (no larger than the ring size) in or out of
+ * the ring, waiting as needed.
+ * ring_pop() returns 0 if the ring is closed and empty, 1 otherwise. */
+void ring_push(struct ring *ring, const void *data, size_t len);
+int ring_pop(struct ring *ring, void *data, size_t len);
+
+static inline void *ring_ptr(struct ring *ring, uint64_t pos)
+{
+    return ring->buf + (pos & (ring->size - 1));
+}
+
+#endif
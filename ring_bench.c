@@ -0,0 +1,201 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Sample ring throughput benchmark.
+//
+// Stream samples through a ring the way the pipeline's phase and sync
+// threads use the dphi ring: the producer writes one block at a time, and
+// the consumer reads each block in place together with the frame
+// lookahead that follows it, then releases the block. Time this through
+// the double-mapped ring (ring.c) against the copying ring it replaced, a
+// buffer with the first MIRROR_BYTES duplicated past its end that
+// ring_commit() kept up to date with memcpy.
+//
+// Both run in one thread, so what is measured is the cost of the copies
+// and of the ring bookkeeping, not of waiting for another thread.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "demod.h"
+#include "ring.h"
+
+#define RING_BYTES   (1 << 22)    // as the pipeline's sample rings
+#define MIRROR_BYTES (1 << 18)    // the old mirror size, 128k samples
+#define BLOCK_BYTES  (16384 * 2)  // one phase thread block of dphi samples
+#define SPAN_BYTES   (BLOCK_BYTES + DEMOD_LOOKAHEAD * 2)
+
+#define STREAM_BYTES (1ULL << 30) // bytes streamed per run
+#define RUNS 5                    // best of
+
+#if SPAN_BYTES > MIRROR_BYTES
+#error "the span read in place must fit in the mirror area"
+#endif
+
+// The copying ring, single-threaded: just the buffer handling of the old
+// ring_reserve() / ring_commit() / ring_ptr()
+struct copy_ring {
+    uint8_t *buf;
+    uint64_t head;
+};
+
+static void *copy_reserve(struct copy_ring *ring)
+{
+    return ring->buf + (ring->head & (RING_BYTES - 1));
+}
+
+static void copy_commit(struct copy_ring *ring, size_t len)
+{
+    size_t offset = ring->head & (RING_BYTES - 1);
+
+    // keep the mirror area and the start of the buffer identical
+    if (offset + len > RING_BYTES)
+        memcpy(ring->buf, ring->buf + RING_BYTES, offset + len - RING_BYTES);
+    if (offset < MIRROR_BYTES) {
+        size_t end = (offset + len < MIRROR_BYTES ? offset + len : MIRROR_BYTES);
+        memcpy(ring->buf + RING_BYTES + offset, ring->buf + offset, end - offset);
+    }
+
+    ring->head += len;
+}
+
+static const uint8_t *copy_ptr(struct copy_ring *ring, uint64_t pos)
+{
+    return ring->buf + (pos & (RING_BYTES - 1));
+}
+
+// source data for the producer, standing in for the phase conversion
+static uint8_t block[BLOCK_BYTES];
+
+// what the consumer does with a span: look at every 64-bit word
+static uint64_t consume(const uint8_t *span)
+{
+    const uint64_t *p = (const uint64_t *) span;
+    uint64_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < SPAN_BYTES / 8; ++i)
+        sum += p[i];
+    return sum;
+}
+
+static double monotonic_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Stream STREAM_BYTES through the copying ring; returns bytes per second
+static double run_copy(uint64_t *checksum)
+{
+    struct copy_ring ring;
+    uint64_t pos = 0, sum = 0;
+    double start, elapsed;
+
+    if (!(ring.buf = malloc(RING_BYTES + MIRROR_BYTES))) {
+        perror("malloc");
+        exit(1);
+    }
+    ring.head = 0;
+
+    start = monotonic_seconds();
+    while (pos < STREAM_BYTES) {
+        memcpy(copy_reserve(&ring), block, BLOCK_BYTES);
+        copy_commit(&ring, BLOCK_BYTES);
+
+        while (ring.head - pos >= SPAN_BYTES) {
+            sum += consume(copy_ptr(&ring, pos));
+            pos += BLOCK_BYTES;
+        }
+    }
+    elapsed = monotonic_seconds() - start;
+
+    free(ring.buf);
+    *checksum = sum;
+    return pos / elapsed;
+}
+
+// Stream STREAM_BYTES through the double-mapped ring; returns bytes per
+// second
+static double run_mapped(uint64_t *checksum)
+{
+    struct ring ring;
+    uint64_t head = 0, pos = 0, sum = 0;
+    double start, elapsed;
+    size_t avail;
+
+    if (ring_init(&ring, RING_BYTES) < 0) {
+        perror("ring_init");
+        exit(1);
+    }
+
+    start = monotonic_seconds();
+    while (pos < STREAM_BYTES) {
+        memcpy(ring_reserve(&ring, BLOCK_BYTES, &avail), block, BLOCK_BYTES);
+        ring_commit(&ring, BLOCK_BYTES);
+        head += BLOCK_BYTES;
+
+        while (head - pos >= SPAN_BYTES) {
+            ring_wait_readable(&ring, pos, SPAN_BYTES);
+            sum += consume(ring_ptr(&ring, pos));
+            pos += BLOCK_BYTES;
+            ring_release(&ring, pos);
+        }
+    }
+    elapsed = monotonic_seconds() - start;
+
+    ring_destroy(&ring);
+    *checksum = sum;
+    return pos / elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    double best_copy = 0, best_mapped = 0;
+    uint64_t sum_copy, sum_mapped;
+    int i;
+
+    for (i = 0; i < BLOCK_BYTES; ++i)
+        block[i] = (uint8_t) (i * 7 + 1);
+
+    for (i = 0; i < RUNS; ++i) {
+        double rate = run_copy(&sum_copy);
+        if (rate > best_copy)
+            best_copy = rate;
+
+        rate = run_mapped(&sum_mapped);
+        if (rate > best_mapped)
+            best_mapped = rate;
+
+        if (sum_copy != sum_mapped) {
+            fprintf(stderr, "copying and double-mapped rings read different data\n");
+            return 1;
+        }
+    }
+
+    printf("%u byte blocks, read in place as %u byte spans, best of %d runs of %llu MB\n",
+           BLOCK_BYTES, SPAN_BYTES, RUNS, STREAM_BYTES >> 20);
+    printf("%-24s %10s\n", "ring", "MB/s");
+    printf("%-24s %10.0f\n", "copy into mirror", best_copy / 1e6);
+    printf("%-24s %10.0f\n", "double-mapped", best_mapped / 1e6);
+    printf("%-24s %9.2fx\n", "speedup", best_mapped / best_copy);
+    return 0;
+}
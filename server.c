@@ -0,0 +1,387 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "ring.h"
+#include "server.h"
+
+// epoll event data for the non-client descriptors; clients use their
+// index in server.clients
+#define EVENT_LISTEN (SERVER_MAX_CLIENTS)
+#define EVENT_WAKE   (SERVER_MAX_CLIENTS + 1)
+
+// Each client's queue is a mirrored buffer (see mirror_alloc) with
+// absolute head and tail positions, so the data between them can always
+// be copied in or sent with a single call.
+struct client {
+    int fd;                 // -1 if this slot is free
+    uint8_t *buf;
+    uint64_t head;          // end of queued data
+    uint64_t tail;          // start of unsent data
+    int overflowed;         // queue overflowed; disconnect
+    int want_out;           // registered for EPOLLOUT
+    char name[64];          // peer address, for messages
+};
+
+static struct {
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;            // eventfd: data queued, or stopping
+    atomic_int stopping;
+    pthread_t thread;
+
+    // protects everything below, and the clients' queues (but see the
+    // server thread functions further down)
+    pthread_mutex_t lock;
+    int nclients;
+    struct client clients[SERVER_MAX_CLIENTS];
+} server = { .listen_fd = -1, .epoll_fd = -1, .wake_fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void *server_thread(void *arg);
+
+static int epoll_add(int fd, uint32_t events, uint32_t data)
+{
+    struct epoll_event ev = { .events = events, .data.u32 = data };
+    return epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int server_start(int port)
+{
+    struct sockaddr_in addr;
+    int one = 1;
+    int i, err;
+
+    for (i = 0; i < SERVER_MAX_CLIENTS; ++i)
+        server.clients[i].fd = -1;
+
+    server.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server.listen_fd < 0)
+        return -1;
+
+    setsockopt(server.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(server.listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        listen(server.listen_fd, 16) < 0)
+        goto fail;
+
+    if ((server.epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+        (server.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 ||
+        epoll_add(server.listen_fd, EPOLLIN, EVENT_LISTEN) < 0 ||
+        epoll_add(server.wake_fd, EPOLLIN, EVENT_WAKE) < 0)
+        goto fail;
+
+    if ((err = pthread_create(&server.thread, NULL, server_thread, NULL)) != 0) {
+        errno = err;
+        goto fail;
+    }
+
+    return 0;
+
+ fail:
+    err = errno;
+    if (server.wake_fd >= 0)
+        close(server.wake_fd);
+    if (server.epoll_fd >= 0)
+        close(server.epoll_fd);
+    close(server.listen_fd);
+    server.listen_fd = server.epoll_fd = server.wake_fd = -1;
+    errno = err;
+    return -1;
+}
+
+static void wake_server(void)
+{
+    uint64_t one = 1;
+    if (write(server.wake_fd, &one, sizeof(one)) < 0) {
+        // EAGAIN: the counter is saturated, so a wakeup is pending anyway
+    }
+}
+
+void server_send(const void *data, size_t len)
+{
+    int i, queued = 0;
+
+    pthread_mutex_lock(&server.lock);
+    for (i = 0; i < SERVER_MAX_CLIENTS && server.nclients > 0; ++i) {
+        struct client *c = &server.clients[i];
+
+        if (c->fd < 0 || c->overflowed)
+            continue;
+
+        if (SERVER_QUEUE_BYTES - (c->head - c->tail) < len) {
+            // fallen too far behind; the server thread disconnects it
+            c->overflowed = 1;
+        } else {
+            memcpy(c->buf + (c->head % SERVER_QUEUE_BYTES), data, len);
+            c->head += len;
+        }
+        queued = 1;
+    }
+    pthread_mutex_unlock(&server.lock);
+
+    if (queued)
+        wake_server();
+}
+
+void server_stop(void)
+{
+    if (server.listen_fd < 0)
+        return;
+
+    server.stopping = 1;
+    wake_server();
+    pthread_join(server.thread, NULL);
+
+    close(server.wake_fd);
+    close(server.epoll_fd);
+    close(server.listen_fd);
+    server.listen_fd = server.epoll_fd = server.wake_fd = -1;
+}
+
+// The functions below run on the server thread, which is the only one
+// that changes a client's fd, buf, tail or want_out. It takes the lock
+// only to publish those changes and to read what server_send() changes
+// (head and overflowed); system calls are made without it, so the
+// output path never waits behind a slow socket.
+
+static void client_close(struct client *c, const char *why)
+{
+    int fd = c->fd;
+    uint8_t *buf = c->buf;
+
+    pthread_mutex_lock(&server.lock);
+    c->fd = -1;
+    c->buf = NULL;
+    --server.nclients;
+    pthread_mutex_unlock(&server.lock);
+
+    if (why)
+        fprintf(stderr, "server: disconnecting %s: %s\n", c->name, why);
+
+    close(fd); // also removes it from the epoll set
+    mirror_free(buf, SERVER_QUEUE_BYTES);
+}
+
+// Send as much queued data as the socket will take. server_send() only
+// appends beyond 'head', so the data between the tail and the head seen
+// here stays put while it is sent.
+static void client_send(struct client *c)
+{
+    uint64_t head, tail;
+    int overflowed, want_out;
+
+    pthread_mutex_lock(&server.lock);
+    head = c->head;
+    tail = c->tail;
+    overflowed = c->overflowed;
+    pthread_mutex_unlock(&server.lock);
+
+    if (overflowed) {
+        client_close(c, "too far behind");
+        return;
+    }
+
+    while (head > tail) {
+        ssize_t n = send(c->fd, c->buf + (tail % SERVER_QUEUE_BYTES), head - tail,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                client_close(c, strerror(errno));
+                return;
+            }
+            break;
+        }
+        tail += n;
+    }
+
+    pthread_mutex_lock(&server.lock);
+    c->tail = tail;
+    want_out = (c->head > c->tail);
+    pthread_mutex_unlock(&server.lock);
+
+    if (c->want_out != want_out) {
+        // wait for room in the socket only while something is queued
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = c - server.clients };
+        c->want_out = want_out;
+        if (c->want_out)
+            ev.events |= EPOLLOUT;
+        epoll_ctl(server.epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    }
+}
+
+static void accept_clients(void)
+{
+    for (;;) {
+        struct sockaddr_in addr;
+        socklen_t addrlen = sizeof(addr);
+        struct client *c = NULL;
+        char name[sizeof(c->name)];
+        uint8_t *buf;
+        int fd, i;
+
+        fd = accept4(server.listen_fd, (struct sockaddr *) &addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                perror("server: accept");
+            return;
+        }
+
+        snprintf(name, sizeof(name), "%s:%u", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+
+        // only this thread fills slots, so a free one stays free
+        for (i = 0; i < SERVER_MAX_CLIENTS; ++i) {
+            if (server.clients[i].fd < 0) {
+                c = &server.clients[i];
+                break;
+            }
+        }
+
+        if (!c) {
+            fprintf(stderr, "server: rejecting %s: too many clients (%d)\n", name, SERVER_MAX_CLIENTS);
+            close(fd);
+            continue;
+        }
+
+        if (!(buf = mirror_alloc(SERVER_QUEUE_BYTES))) {
+            fprintf(stderr, "server: rejecting %s: %s\n", name, strerror(errno));
+            close(fd);
+            continue;
+        }
+
+        if (epoll_add(fd, EPOLLIN, i) < 0) {
+            fprintf(stderr, "server: rejecting %s: %s\n", name, strerror(errno));
+            mirror_free(buf, SERVER_QUEUE_BYTES);
+            close(fd);
+            continue;
+        }
+
+        memcpy(c->name, name, sizeof(name));
+        c->want_out = 0;
+
+        pthread_mutex_lock(&server.lock);
+        c->fd = fd;
+        c->buf = buf;
+        c->head = c->tail = 0;
+        c->overflowed = 0;
+        ++server.nclients;
+        pthread_mutex_unlock(&server.lock);
+    }
+}
+
+// Clients aren't expected to send anything; discard it, and notice EOF.
+static void client_readable(struct client *c)
+{
+    char discard[512];
+
+    for (;;) {
+        ssize_t n = recv(c->fd, discard, sizeof(discard), MSG_DONTWAIT);
+        if (n > 0)
+            continue;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+            client_close(c, NULL);
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            client_close(c, strerror(errno));
+        return;
+    }
+}
+
+static void *server_thread(void *arg)
+{
+    struct epoll_event events[16];
+    int i, n;
+
+    while (!server.stopping) {
+        n = epoll_wait(server.epoll_fd, events, 16, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("server: epoll_wait");
+            break;
+        }
+
+        for (i = 0; i < n; ++i) {
+            uint32_t which = events[i].data.u32;
+
+            if (which == EVENT_LISTEN) {
+                accept_clients();
+            } else if (which == EVENT_WAKE) {
+                struct client *ready[SERVER_MAX_CLIENTS];
+                uint64_t count;
+                int j, nready = 0;
+
+                if (read(server.wake_fd, &count, sizeof(count)) < 0) {
+                    // EAGAIN: already consumed
+                }
+
+                // clients already waiting for EPOLLOUT are sent to when
+                // their socket has room
+                pthread_mutex_lock(&server.lock);
+                for (j = 0; j < SERVER_MAX_CLIENTS; ++j) {
+                    struct client *c = &server.clients[j];
+                    if (c->fd >= 0 && (c->overflowed || (c->head > c->tail && !c->want_out)))
+                        ready[nready++] = c;
+                }
+                pthread_mutex_unlock(&server.lock);
+
+                for (j = 0; j < nready; ++j)
+                    client_send(ready[j]);
+            } else {
+                struct client *c = &server.clients[which];
+
+                if (c->fd >= 0 && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                    client_readable(c);
+                if (c->fd >= 0 && (events[i].events & EPOLLOUT))
+                    client_send(c);
+            }
+        }
+    }
+
+    // last chance for whatever is still queued, then hang up
+    for (i = 0; i < SERVER_MAX_CLIENTS; ++i) {
+        struct client *c = &server.clients[i];
+        if (c->fd >= 0) {
+            client_send(c);
+            if (c->fd >= 0)
+                client_close(c, NULL);
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,48 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP978_SERVER_H
+#define DUMP978_SERVER_H
+
+#include <stddef.h>
+
+// TCP fan-out of dump978's output to any number of clients.
+//
+// One thread runs an epoll loop over the listening socket and the
+// (non-blocking) client sockets. Output is handed over with
+// server_send(), which copies it into a bounded queue per client and
+// returns without doing any socket I/O; the server thread sends from
+// the queues as the sockets allow. A client whose queue would overflow
+// is disconnected, so a slow client never holds up the caller.
+
+#define SERVER_MAX_CLIENTS 64
+#define SERVER_QUEUE_BYTES (256*1024) // per client; a multiple of the page size
+
+/* Listen on TCP 'port' on all interfaces and start the server thread.
+ * Returns 0 on success, -1 on failure with errno set. */
+int server_start(int port);
+
+/* Queue 'len' bytes (at most SERVER_QUEUE_BYTES) for every connected
+ * client. Data should be whole frames, so that a client that connects
+ * part way through still sees complete lines or records. */
+void server_send(const void *data, size_t len);
+
+/* Make a last attempt to send queued data, disconnect all clients, and
+ * stop the server thread. */
+void server_stop(void);
+
+#endif
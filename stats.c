@@ -0,0 +1,275 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "stats.h"
+
+// Counter blocks, one per thread. A thread claims a free one the first
+// time it counts anything; when it exits, its counts are added to
+// 'retired' and the block is freed for reuse. Threads beyond
+// STATS_MAX_THREADS share the last block, and may lose counts.
+#define STATS_MAX_THREADS 64
+
+_Thread_local struct stats *stats_local;
+
+static struct stats blocks[STATS_MAX_THREADS];
+static int block_used[STATS_MAX_THREADS];
+static struct stats retired;
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t block_key;
+static pthread_once_t block_key_once = PTHREAD_ONCE_INIT;
+
+static const char *stats_path;
+static int stats_interval;
+static sigset_t stats_signals;
+static pthread_t stats_thread_id;
+static atomic_int stopping;
+static int started;
+
+// when stats_start() was called, to report uptime and calibrate ticks
+static uint64_t start_ticks;
+static double start_time;
+
+static const char *const stage_names[STAGE_COUNT] = { "frontend", "sync", "demod", "fec", "output" };
+static const char *const type_names[2] = { "adsb", "uplink" };
+
+static double monotonic_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long get(_Atomic uint64_t *counter)
+{
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void add(_Atomic uint64_t *to, _Atomic uint64_t *from)
+{
+    atomic_store_explicit(to, get(to) + get(from), memory_order_relaxed);
+}
+
+// Add the counters in 'from' to 'to'
+static void stats_add(struct stats *to, struct stats *from)
+{
+    int i;
+
+    add(&to->reads, &from->reads);
+    add(&to->read_bytes, &from->read_bytes);
+    if (get(&from->max_read) > get(&to->max_read))
+        atomic_store_explicit(&to->max_read, get(&from->max_read), memory_order_relaxed);
+    add(&to->samples, &from->samples);
+    add(&to->squelch_searched, &from->squelch_searched);
+    add(&to->squelch_skipped, &from->squelch_skipped);
+    add(&to->queue_frames_written, &from->queue_frames_written);
+    add(&to->queue_frames_dropped, &from->queue_frames_dropped);
+    add(&to->queue_bytes_dropped, &from->queue_bytes_dropped);
+
+    for (i = 0; i < 2; ++i) {
+        add(&to->frametype[i].candidates, &from->frametype[i].candidates);
+        add(&to->frametype[i].sync_rejected, &from->frametype[i].sync_rejected);
+        add(&to->frametype[i].rs_failed, &from->frametype[i].rs_failed);
+        add(&to->frametype[i].frames, &from->frametype[i].frames);
+        add(&to->frametype[i].rs_corrected, &from->frametype[i].rs_corrected);
+        add(&to->frametype[i].rs_errors, &from->frametype[i].rs_errors);
+    }
+
+    for (i = 0; i < STAGE_COUNT; ++i) {
+        add(&to->calls[i], &from->calls[i]);
+        add(&to->ticks[i], &from->ticks[i]);
+    }
+}
+
+// Thread exit: keep the thread's counts, and free its block
+static void block_release(void *p)
+{
+    struct stats *block = p;
+
+    pthread_mutex_lock(&blocks_lock);
+    stats_add(&retired, block);
+    memset(block, 0, sizeof(*block));
+    block_used[block - blocks] = 0;
+    pthread_mutex_unlock(&blocks_lock);
+}
+
+static void block_key_init(void)
+{
+    pthread_key_create(&block_key, block_release);
+}
+
+struct stats *stats_claim(void)
+{
+    int i;
+
+    pthread_once(&block_key_once, block_key_init);
+
+    pthread_mutex_lock(&blocks_lock);
+    for (i = 0; i < STATS_MAX_THREADS - 1 && block_used[i]; ++i)
+        ;
+    if (i < STATS_MAX_THREADS - 1) {
+        block_used[i] = 1;
+        pthread_setspecific(block_key, &blocks[i]);
+    }
+    pthread_mutex_unlock(&blocks_lock);
+
+    stats_local = &blocks[i];
+    return stats_local;
+}
+
+// Sum the counts of all threads, past and present, into 'total'
+static void stats_sum(struct stats *total)
+{
+    int i;
+
+    memset(total, 0, sizeof(*total));
+
+    pthread_mutex_lock(&blocks_lock);
+    stats_add(total, &retired);
+    for (i = 0; i < STATS_MAX_THREADS; ++i)
+        stats_add(total, &blocks[i]);
+    pthread_mutex_unlock(&blocks_lock);
+}
+
+static void write_json(FILE *f)
+{
+    double elapsed = monotonic_now() - start_time;
+    double ticks_per_second = (elapsed > 0 ? (stats_ticks() - start_ticks) / elapsed : 0);
+    struct stats stats;
+    unsigned long long reads;
+    struct timespec now;
+    int i;
+
+    stats_sum(&stats);
+    reads = get(&stats.reads);
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"now\": %.3f,\n", now.tv_sec + now.tv_nsec / 1e9);
+    fprintf(f, "  \"uptime\": %.3f,\n", elapsed);
+    fprintf(f, "  \"input\": { \"reads\": %llu, \"bytes\": %llu, \"mean_read\": %.0f, \"max_read\": %llu, \"samples\": %llu },\n",
+            reads, get(&stats.read_bytes), reads ? (double) get(&stats.read_bytes) / reads : 0.0,
+            get(&stats.max_read), get(&stats.samples));
+    fprintf(f, "  \"squelch\": { \"searched\": %llu, \"skipped\": %llu },\n",
+            get(&stats.squelch_searched), get(&stats.squelch_skipped));
+
+    for (i = 0; i < 2; ++i) {
+        struct stats_frames *t = &stats.frametype[i];
+        fprintf(f, "  \"%s\": { \"candidates\": %llu, \"sync_rejected\": %llu, \"rs_failed\": %llu, "
+                "\"frames\": %llu, \"rs_corrected\": %llu, \"rs_errors\": %llu },\n",
+                type_names[i], get(&t->candidates), get(&t->sync_rejected), get(&t->rs_failed),
+                get(&t->frames), get(&t->rs_corrected), get(&t->rs_errors));
+    }
+
+    fprintf(f, "  \"output_queue\": { \"frames_written\": %llu, \"frames_dropped\": %llu, \"bytes_dropped\": %llu },\n",
+            get(&stats.queue_frames_written), get(&stats.queue_frames_dropped), get(&stats.queue_bytes_dropped));
+
+    fprintf(f, "  \"ticks_per_second\": %.0f,\n", ticks_per_second);
+    fprintf(f, "  \"stages\": {\n");
+    for (i = 0; i < STAGE_COUNT; ++i) {
+        unsigned long long ticks = get(&stats.ticks[i]);
+        fprintf(f, "    \"%s\": { \"calls\": %llu, \"ticks\": %llu, \"seconds\": %.6f }%s\n",
+                stage_names[i], get(&stats.calls[i]), ticks,
+                ticks_per_second > 0 ? ticks / ticks_per_second : 0.0,
+                i + 1 < STAGE_COUNT ? "," : "");
+    }
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+}
+
+// Replace the stats file, via a temporary file so readers never see a
+// partial one
+static void write_file(void)
+{
+    char tmp[4096];
+    FILE *f;
+
+    if (!stats_path)
+        return;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", stats_path);
+    if (!(f = fopen(tmp, "w"))) {
+        perror(tmp);
+        return;
+    }
+
+    write_json(f);
+    if (fclose(f) != 0 || rename(tmp, stats_path) < 0)
+        perror(stats_path);
+}
+
+// Wait for SIGUSR1 (dump to stderr) or the end of each interval (write
+// the stats file). stats_stop() sends SIGUSR1 after setting 'stopping'.
+static void *stats_thread(void *arg)
+{
+    for (;;) {
+        struct timespec timeout = { stats_interval, 0 };
+        int sig = sigtimedwait(&stats_signals, NULL, stats_path ? &timeout : NULL);
+
+        if (atomic_load(&stopping))
+            break;
+
+        if (sig == SIGUSR1) {
+            write_json(stderr);
+            fflush(stderr);
+        } else if (sig < 0 && errno == EAGAIN) {
+            write_file();
+        }
+    }
+
+    return NULL;
+}
+
+int stats_start(const char *path, int interval)
+{
+    int err;
+
+    stats_path = path;
+    stats_interval = interval;
+    start_ticks = stats_ticks();
+    start_time = monotonic_now();
+
+    // block SIGUSR1 here and in every thread started after this, so that
+    // only sigtimedwait() sees it
+    sigemptyset(&stats_signals);
+    sigaddset(&stats_signals, SIGUSR1);
+    if ((err = pthread_sigmask(SIG_BLOCK, &stats_signals, NULL)) != 0 ||
+        (err = pthread_create(&stats_thread_id, NULL, stats_thread, NULL)) != 0) {
+        errno = err;
+        return -1;
+    }
+
+    started = 1;
+    return 0;
+}
+
+void stats_stop(void)
+{
+    if (!started)
+        return;
+
+    atomic_store(&stopping, 1);
+    pthread_kill(stats_thread_id, SIGUSR1);
+    pthread_join(stats_thread_id, NULL);
+    write_file();
+}
@@ -0,0 +1,142 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP978_STATS_H
+#define DUMP978_STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Performance counters for dump978.
+//
+// Each thread that counts anything gets its own block of counters, on
+// cache lines of its own, and is the only thread that writes to it, so
+// counting is a plain load and store with no locked instructions and no
+// sharing between threads. The blocks are summed when the counters are
+// reported. Time is measured in ticks of the cheapest available cycle
+// counter (see stats_ticks()) and converted to seconds when reported;
+// stages are timed per buffer or per candidate, not per sample.
+
+enum stats_stage {
+    STAGE_FRONTEND, // phase and energy conversion
+    STAGE_SYNC,     // sync word search
+    STAGE_DEMOD,    // sync word check and bit slicing, excluding FEC
+    STAGE_FEC,      // error correction
+    STAGE_OUTPUT,   // formatting and writing frames
+    STAGE_COUNT
+};
+
+// Per frame type
+struct stats_frames {
+    _Atomic uint64_t candidates;    // sync word matches found by the search
+    _Atomic uint64_t sync_rejected; // rejected by check_sync_word at both alignments
+    _Atomic uint64_t rs_failed;     // passed the sync check, but error correction failed
+    _Atomic uint64_t frames;        // decoded
+    _Atomic uint64_t rs_corrected;  // decoded frames that needed correction
+    _Atomic uint64_t rs_errors;     // total errors corrected in those
+};
+
+// The counters are atomic only so that the stats thread never sees a
+// torn value on 32-bit platforms; the owning thread updates them with
+// relaxed loads and stores.
+struct stats {
+    _Alignas(64) _Atomic uint64_t reads;    // reads of input
+    _Atomic uint64_t read_bytes;
+    _Atomic uint64_t max_read;      // largest single read
+    _Atomic uint64_t samples;       // samples converted by the front end
+    _Atomic uint64_t squelch_searched;  // samples searched for sync words with the squelch open
+    _Atomic uint64_t squelch_skipped;   // samples skipped by the squelch
+    _Atomic uint64_t queue_frames_written;  // --output-queue (see writer.h)
+    _Atomic uint64_t queue_frames_dropped;
+    _Atomic uint64_t queue_bytes_dropped;
+
+    struct stats_frames frametype[2];   // indexed by demod_frame_type_t (demod.h)
+
+    _Atomic uint64_t calls[STAGE_COUNT];
+    _Atomic uint64_t ticks[STAGE_COUNT];
+};
+
+// The calling thread's counters; NULL until it first counts something
+extern _Thread_local struct stats *stats_local;
+
+/* Allocate a block of counters for the calling thread. When the thread
+ * exits, its counts are kept and the block is reused. */
+struct stats *stats_claim(void);
+
+static inline struct stats *stats_mine(void)
+{
+    struct stats *s = stats_local;
+    return s ? s : stats_claim();
+}
+
+#define STATS_ADD(counter, n) do {                                      \
+        struct stats *s_ = stats_mine();                                \
+        uint64_t v_ = atomic_load_explicit(&s_->counter, memory_order_relaxed); \
+        atomic_store_explicit(&s_->counter, v_ + (n), memory_order_relaxed); \
+    } while (0)
+
+#define STATS_MAX(counter, n) do {                                      \
+        struct stats *s_ = stats_mine();                                \
+        if ((uint64_t) (n) > atomic_load_explicit(&s_->counter, memory_order_relaxed)) \
+            atomic_store_explicit(&s_->counter, (n), memory_order_relaxed); \
+    } while (0)
+
+// Current value of the cycle counter: the TSC on x86, the virtual counter
+// on aarch64 and on 32-bit ARM cores that have the generic timer (ARMv7
+// with the virtualization extensions, e.g. Cortex-A7, or ARMv8 in AArch32
+// state), or the monotonic clock in nanoseconds elsewhere.
+static inline uint64_t stats_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#elif defined(__arm__) && (defined(__ARM_ARCH_7VE__) || __ARM_ARCH >= 8)
+    uint32_t lo, hi;
+    __asm__ volatile("mrrc p15, 1, %0, %1, c14" : "=r" (lo), "=r" (hi));
+    return ((uint64_t) hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// Account one call of 'stage' that started at stats_ticks() value 'start'
+static inline void stats_stage_done(enum stats_stage stage, uint64_t start)
+{
+    STATS_ADD(ticks[stage], stats_ticks() - start);
+    STATS_ADD(calls[stage], 1);
+}
+
+/* Start the stats thread. Every 'interval' seconds it writes the counters
+ * as JSON to 'path' (if not NULL), and on SIGUSR1 it writes them to
+ * stderr. Must be called before any other threads are started, so that
+ * they all block SIGUSR1. Returns 0 on success, -1 with errno set. */
+int stats_start(const char *path, int interval);
+
+/* Write the final counters to the stats file, and stop the stats thread */
+void stats_stop(void);
+
+#endif
@@ -41,4 +41,22 @@
 #define UPLINK_FRAME_DATA_BYTES (UPLINK_FRAME_DATA_BITS/8)
 #define UPLINK_FRAME_BYTES (UPLINK_FRAME_BITS/8)
 
+// Binary frame records, written by "dump978 --format binary" and accepted
+// by the reader alongside text lines. Each record is a fixed header
+// followed by the frame data; multi-byte fields are little-endian.
+//
+//   offset  size  field
+//        0     1  RECORD_MAGIC
+//        1     1  frame type: '-' for ADS-B, '+' for uplink (as text)
+//        2     2  frame data length in bytes
+//        4     8  sample offset of the start of the frame
+//       12     2  signal strength, signed, 1/100 dBFS
+//       14     2  SNR, signed, 1/10 dB; RECORD_SNR_UNKNOWN if unknown
+//       16     1  number of Reed-Solomon errors corrected
+//       17        frame data
+
+#define RECORD_MAGIC (0x97)
+#define RECORD_HEADER_BYTES (17)
+#define RECORD_SNR_UNKNOWN (-32768)
+
 #endif
@@ -24,6 +24,7 @@
 #include "uat.h"
 #include "uat_decode.h"
 #include "reader.h"
+#include "crc_tables.h"
 
 static void checksum_and_send(uint8_t *frame, int len, uint32_t parity);
 
@@ -578,30 +579,7 @@ static void maybe_send_callsign(struct uat_adsb_mdb *mdb)
     }
 }
 
-// Generator polynomial for the Mode S CRC:
-#define MODES_GENERATOR_POLY 0xfff409U
-
-// CRC values for all single-byte messages;
-// used to speed up CRC calculation.
-static uint32_t crc_table[256];
-
-static void initCrcTables()
-{
-    int i;
-    for (i = 0; i < 256; ++i) {
-        uint32_t c = i << 16;
-        int j;
-        for (j = 0; j < 8; ++j) {
-            if (c & 0x800000)
-                c = (c<<1) ^ MODES_GENERATOR_POLY;
-            else
-                c = (c<<1);
-        }
-
-        crc_table[i] = c & 0x00ffffff;
-    }
-}
-
+// Mode S CRC, using crc_table (generated by gen_tables.c)
 static uint32_t checksum(uint8_t *message, int n)
 {
     uint32_t rem = 0;
@@ -718,8 +696,6 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    initCrcTables();
-
     reader = dump978_reader_new(0,0);
     if (!reader) {
         perror("dump978_reader_new");
@@ -0,0 +1,220 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "ring.h"
+#include "writer.h"
+#include "stats.h"
+
+// The queue is a ring (see ring.h) of chunks, each a header followed by
+// the data. The tail always sits on a chunk boundary.
+//
+// To drop the oldest chunk, the producer moves the tail past it with
+// ring_release_if(). The writer thread therefore never writes straight
+// from the ring: it copies chunks out first, then claims them by moving
+// the tail with ring_release_if() in turn. If the producer got there
+// first, what was copied may have been overwritten, and is discarded.
+struct chunk_header {
+    uint32_t len;
+    uint32_t frames;
+};
+
+static struct {
+    int fd;
+    writer_drop_t policy;
+    struct ring ring;
+    uint8_t *out;           // writer thread's copy of the chunks it's writing
+    size_t out_size;
+    pthread_t thread;
+
+    _Atomic uint64_t frames_written;
+    _Atomic uint64_t frames_dropped;
+    _Atomic uint64_t bytes_dropped;
+} writer;
+
+static void *writer_thread(void *arg);
+
+int writer_start(int fd, size_t queue_bytes, writer_drop_t policy)
+{
+    size_t size = WRITER_MIN_QUEUE;
+    int err;
+
+    while (size * 2 <= queue_bytes)
+        size *= 2;
+
+    writer.fd = fd;
+    writer.policy = policy;
+    writer.out_size = size / 2;
+
+    if (!(writer.out = malloc(writer.out_size)))
+        return -1;
+
+    if (ring_init(&writer.ring, size) < 0) {
+        free(writer.out);
+        return -1;
+    }
+
+    if ((err = pthread_create(&writer.thread, NULL, writer_thread, NULL)) != 0) {
+        ring_destroy(&writer.ring);
+        free(writer.out);
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void count_dropped(const struct chunk_header *h)
+{
+    atomic_fetch_add_explicit(&writer.frames_dropped, h->frames, memory_order_relaxed);
+    atomic_fetch_add_explicit(&writer.bytes_dropped, h->len, memory_order_relaxed);
+    STATS_ADD(queue_frames_dropped, h->frames);
+    STATS_ADD(queue_bytes_dropped, h->len);
+}
+
+// Producer: discard the oldest queued chunk, unless the writer thread
+// claims it first. If the writer thread has already claimed everything,
+// there is nothing to drop; the caller just retries the reservation.
+static void drop_oldest(void)
+{
+    uint64_t head = atomic_load_explicit(&writer.ring.head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&writer.ring.tail, memory_order_acquire);
+    struct chunk_header h;
+
+    if (tail == head)
+        return;
+
+    memcpy(&h, ring_ptr(&writer.ring, tail), sizeof(h));
+    if (ring_release_if(&writer.ring, tail, tail + sizeof(h) + h.len))
+        count_dropped(&h);
+}
+
+void writer_push(const void *data, size_t len, unsigned frames)
+{
+    struct chunk_header h = { len, frames };
+    size_t need = sizeof(h) + len;
+    size_t avail;
+    uint8_t *p;
+
+    if (need > writer.ring.size / 2) {
+        count_dropped(&h);
+        return;
+    }
+
+    while (!(p = ring_try_reserve(&writer.ring, need, &avail))) {
+        if (writer.policy == WRITER_DROP_NEWEST) {
+            count_dropped(&h);
+            return;
+        }
+
+        // Either a chunk is queued at the tail (tail < head) and can be
+        // dropped, or the writer thread has just released everything
+        // (tail == head) and the retry will succeed. The tail never
+        // passes the head.
+        drop_oldest();
+    }
+
+    memcpy(p, &h, sizeof(h));
+    memcpy(p + sizeof(h), data, len);
+    ring_commit(&writer.ring, need);
+}
+
+void writer_stop(struct writer_stats *stats)
+{
+    ring_close(&writer.ring);
+    pthread_join(writer.thread, NULL);
+    ring_destroy(&writer.ring);
+    free(writer.out);
+
+    if (stats)
+        writer_get_stats(stats);
+}
+
+void writer_get_stats(struct writer_stats *stats)
+{
+    stats->frames_written = atomic_load_explicit(&writer.frames_written, memory_order_relaxed);
+    stats->frames_dropped = atomic_load_explicit(&writer.frames_dropped, memory_order_relaxed);
+    stats->bytes_dropped = atomic_load_explicit(&writer.bytes_dropped, memory_order_relaxed);
+}
+
+static void write_all(const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(writer.fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return; // non-blocking output is full; drop the rest
+            // as for synchronous output, anything else won't go away
+            perror("write");
+            exit(1);
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+static void *writer_thread(void *arg)
+{
+    for (;;) {
+        uint64_t tail = atomic_load_explicit(&writer.ring.tail, memory_order_acquire);
+        size_t avail = ring_wait_readable(&writer.ring, tail, 1);
+        uint64_t pos = tail, end = tail + avail;
+        size_t used = 0;
+        unsigned frames = 0;
+
+        if (avail == 0)
+            break; // closed and empty
+
+        // Copy out as many whole chunks as fit. If the producer has
+        // dropped any of them meanwhile, a header may be garbage; the
+        // bounds checks keep the copy within the ring, and the release
+        // below fails.
+        while (pos < end) {
+            struct chunk_header h;
+
+            if (end - pos < sizeof(h))
+                break;
+
+            memcpy(&h, ring_ptr(&writer.ring, pos), sizeof(h));
+            if (h.len > end - pos - sizeof(h) || h.len > writer.out_size - used)
+                break;
+
+            memcpy(writer.out + used, ring_ptr(&writer.ring, pos + sizeof(h)), h.len);
+            used += h.len;
+            frames += h.frames;
+            pos += sizeof(h) + h.len;
+        }
+
+        if (pos == tail || !ring_release_if(&writer.ring, tail, pos))
+            continue; // lost a race with drop_oldest(); try again
+
+        write_all(writer.out, used);
+        atomic_fetch_add_explicit(&writer.frames_written, frames, memory_order_relaxed);
+        STATS_ADD(queue_frames_written, frames);
+    }
+
+    return NULL;
+}
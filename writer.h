@@ -0,0 +1,61 @@
+//
+// Copyright 2026, the dump978 contributors
+//
+
+// This file is free software: you may copy, redistribute and/or modify it
+// under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 2 of the License, or (at your
+// option) any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DUMP978_WRITER_H
+#define DUMP978_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Asynchronous output: chunks of output are queued in a fixed-size ring
+// and written to a file descriptor by a dedicated thread, so a consumer
+// that stops reading can't block the caller. When the queue is full,
+// either the oldest queued chunks or the new chunk are dropped.
+//
+// writer_push() never waits for the writer thread or the consumer, and
+// takes no lock while the writer thread is busy. When the output rate is
+// low the writer thread is usually asleep, though, and then each push
+// wakes it, which costs a mutex and a futex call.
+
+typedef enum { WRITER_DROP_OLDEST, WRITER_DROP_NEWEST } writer_drop_t;
+
+#define WRITER_MIN_QUEUE (128*1024)
+
+struct writer_stats {
+    uint64_t frames_written;
+    uint64_t frames_dropped;
+    uint64_t bytes_dropped;
+};
+
+/* Start writing to 'fd' from a queue of 'queue_bytes' (rounded down to a
+ * power of two, at least WRITER_MIN_QUEUE). Returns 0 on success, -1 on
+ * failure with errno set. */
+int writer_start(int fd, size_t queue_bytes, writer_drop_t policy);
+
+/* Queue 'len' bytes holding 'frames' complete frames. Chunks larger than
+ * half the queue are dropped. */
+void writer_push(const void *data, size_t len, unsigned frames);
+
+/* Fill in 'stats' with the counts so far. May be called from any thread
+ * while the writer is running. */
+void writer_get_stats(struct writer_stats *stats);
+
+/* Write out everything queued, stop the writer thread, and fill in
+ * 'stats' if it is not NULL. */
+void writer_stop(struct writer_stats *stats);
+
+#endif